@@ -0,0 +1,166 @@
+#pragma once
+
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include "String.hpp"
+
+// 数字与字符串的互相转换，接口同标准库的 to_chars / from_chars
+// 整数由这里自己实现：先算出位数，再从末尾往前每次写两位，不需要临时缓冲区
+// 浮点数交给标准库的 std::to_chars（libstdc++ 与 MSVC 都用 Ryu 算法，输出能精确还原的最短表示）
+// appendNumber 直接把数字写进 String 的缓冲区末尾，没有任何临时对象
+
+inline constexpr char _S_digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// 十进制位数：由二进制位数估算，再与一次 10 的幂比较修正，没有循环
+inline unsigned _S_count_digits(std::uint64_t __n) noexcept {
+    static constexpr std::uint64_t __pow10[20] = {
+        1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+        10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+        100000000000ull, 1000000000000ull, 10000000000000ull,
+        100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+        100000000000000000ull, 1000000000000000000ull,
+        10000000000000000000ull,
+    };
+    __n |= 1; // 0 也算一位；偶数加一不会跨过 10 的幂，不影响位数
+    unsigned __bits = 64 - static_cast<unsigned>(std::countl_zero(__n));
+    unsigned __digits = (__bits * 1233) >> 12; // 1233 / 4096 约等于 log10(2)
+    return __digits + (__n >= __pow10[__digits]);
+}
+
+// 把 __n 写到 [__first, __first + __len)，调用者保证 __len 恰好是 __n 的位数
+inline void _S_write_digits(char *__first, unsigned __len, std::uint64_t __n) noexcept {
+    char *__p = __first + __len;
+    while (__n >= 100) {
+        unsigned __r = static_cast<unsigned>(__n % 100);
+        __n /= 100;
+        __p -= 2;
+        std::memcpy(__p, _S_digit_pairs + __r * 2, 2);
+    }
+    if (__n >= 10) {
+        __p -= 2;
+        std::memcpy(__p, _S_digit_pairs + __n * 2, 2);
+    } else {
+        *--__p = static_cast<char>('0' + __n);
+    }
+}
+
+// 位数与输出只处理 64 位以内的值，所以排除 gnu++20 下也算整数的 __int128；字符类型也不当作数字
+template <class _Tp>
+inline constexpr bool _S_is_charconv_integer =
+    std::is_integral_v<_Tp> && sizeof(_Tp) <= sizeof(std::uint64_t) &&
+    !std::is_same_v<_Tp, bool> && !std::is_same_v<_Tp, char> && !std::is_same_v<_Tp, wchar_t> &&
+    !std::is_same_v<_Tp, char8_t> && !std::is_same_v<_Tp, char16_t> && !std::is_same_v<_Tp, char32_t>;
+
+template <class _Tp, std::enable_if_t<_S_is_charconv_integer<_Tp>, int> = 0>
+std::to_chars_result toChars(char *__first, char *__last, _Tp __value) noexcept {
+    using _Up = std::make_unsigned_t<_Tp>;
+    _Up __abs = static_cast<_Up>(__value);
+    if constexpr (std::is_signed_v<_Tp>) {
+        if (__value < 0) {
+            if (__first == __last)
+                return {__last, std::errc::value_too_large};
+            *__first++ = '-';
+            __abs = static_cast<_Up>(_Up(0) - __abs);
+        }
+    }
+    unsigned __len = _S_count_digits(__abs);
+    if (static_cast<std::size_t>(__last - __first) < __len)
+        return {__last, std::errc::value_too_large};
+    _S_write_digits(__first, __len, __abs);
+    return {__first + __len, std::errc()};
+}
+
+template <class _Tp, std::enable_if_t<std::is_floating_point_v<_Tp>, int> = 0>
+std::to_chars_result toChars(char *__first, char *__last, _Tp __value) noexcept {
+    return std::to_chars(__first, __last, __value);
+}
+
+// 只接受十进制，与 std::from_chars 一样：不跳过空白，不接受 '+'，溢出时返回 result_out_of_range
+template <class _Tp, std::enable_if_t<_S_is_charconv_integer<_Tp>, int> = 0>
+std::from_chars_result fromChars(char const *__first, char const *__last, _Tp &__value) noexcept {
+    using _Up = std::make_unsigned_t<_Tp>;
+    char const *__p = __first;
+    bool __neg = false;
+    if constexpr (std::is_signed_v<_Tp>) {
+        if (__p != __last && *__p == '-') {
+            __neg = true;
+            ++__p;
+        }
+    }
+    char const *__digits = __p;
+    _Up __acc = 0;
+    bool __overflow = false;
+    for (; __p != __last; ++__p) {
+        unsigned __d = static_cast<unsigned char>(*__p) - static_cast<unsigned>('0');
+        if (__d > 9)
+            break;
+        if (__acc > (std::numeric_limits<_Up>::max() - __d) / 10)
+            __overflow = true;
+        else
+            __acc = static_cast<_Up>(__acc * 10 + __d);
+    }
+    if (__p == __digits)
+        return {__first, std::errc::invalid_argument};
+    if constexpr (std::is_signed_v<_Tp>) {
+        _Up __limit = static_cast<_Up>(std::numeric_limits<_Tp>::max()) + __neg;
+        __overflow |= __acc > __limit;
+    }
+    if (__overflow)
+        return {__p, std::errc::result_out_of_range};
+    if constexpr (std::is_signed_v<_Tp>) {
+        __value = __neg ? static_cast<_Tp>(_Up(0) - __acc) : static_cast<_Tp>(__acc);
+    } else {
+        __value = __acc;
+    }
+    return {__p, std::errc()};
+}
+
+template <class _Tp, std::enable_if_t<std::is_floating_point_v<_Tp>, int> = 0>
+std::from_chars_result fromChars(char const *__first, char const *__last, _Tp &__value) noexcept {
+    return std::from_chars(__first, __last, __value);
+}
+
+template <class _Tp>
+std::from_chars_result fromChars(std::string_view __sv, _Tp &__value) noexcept {
+    return fromChars(__sv.data(), __sv.data() + __sv.size(), __value);
+}
+
+// 各类型最多需要的字符数
+template <class _Tp>
+inline constexpr std::size_t _S_max_chars =
+    std::is_floating_point_v<_Tp>
+        ? 4 + std::numeric_limits<_Tp>::max_digits10 + 6 // 符号、小数点、'e'、指数符号与三位指数，再留一点余量
+        : std::numeric_limits<_Tp>::digits10 + 2;         // 符号与 digits10 之外的一位
+
+template <class _Tp, std::enable_if_t<_S_is_charconv_integer<_Tp> || std::is_floating_point_v<_Tp>, int> = 0>
+String &appendNumber(String &__s, _Tp __value) {
+    std::size_t __old = __s.size();
+    __s.resize_and_overwrite(__old + _S_max_chars<_Tp>, [&] (char *__p, std::size_t __n) noexcept {
+        return toChars(__p + __old, __p + __n, __value).ptr - __p;
+    });
+    return __s;
+}
+
+template <class _Tp, std::enable_if_t<_S_is_charconv_integer<_Tp> || std::is_floating_point_v<_Tp>, int> = 0>
+String toString(_Tp __value) {
+    String __s;
+    appendNumber(__s, __value);
+    return __s;
+}
@@ -2,3 +2,4 @@
 
 #include "_Function.hpp"
 #include "_MoveOnlyFunction.hpp"
+#include "_FunctionRef.hpp"
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <class _FnSig>
+struct InplaceFunctionVector {
+    // 只在使用了不符合 void(Args...) 模式的 FnSig 时会进入此特化，导致报错
+    // 此处表达式始终为 false，仅为避免编译期就报错，才让其依赖模板参数
+    static_assert(!std::is_same_v<_FnSig, _FnSig>, "not a valid function signature");
+};
+
+// 把大量类型各异的仿函数依次紧密地存放在同一块连续内存中，每条记录是“头部 + 仿函数本身”，长度随仿函数大小而变
+// 头部只有调用函数指针与操作表指针，invoke_all 从头到尾线性扫描，不像 Vector<Function<void()>> 那样可能每个元素都要跳到堆上
+// 同一组参数要传给每个仿函数，所以参数一律以左值传递
+template <class ..._Args>
+struct InplaceFunctionVector<void(_Args...)> {
+private:
+    static constexpr std::size_t _S_align = alignof(std::max_align_t);
+
+    // 调用后返回本条记录的字节数，invoke_all 据此跳到下一条，不必再经操作表读取，省去一次依赖的访存
+    using _Invoker = std::size_t (*)(void *, std::add_lvalue_reference_t<_Args>...);
+
+    // 平凡的操作留空（nullptr），扩容时直接按字节拷贝、析构时跳过
+    struct _FuncOps {
+        std::size_t _M_record_size; // 整条记录（含头部）的字节数，已按 _S_align 对齐
+        void (*_M_move)(void *__dst, void *__src) noexcept; // 移动到 __dst 并析构 __src 中的对象
+        void (*_M_destroy)(void *__p) noexcept;
+    };
+
+    struct _Header {
+        _Invoker _M_invoke;
+        _FuncOps const *_M_ops;
+    };
+
+    static constexpr std::size_t _S_header_size = (sizeof(_Header) + _S_align - 1) / _S_align * _S_align;
+
+    static constexpr std::size_t _S_round_up(std::size_t __n) noexcept {
+        return (__n + _S_align - 1) / _S_align * _S_align;
+    }
+
+    template <class _Fn>
+    struct _FuncImpl { // 对齐要求超过 _S_align 的仿函数不支持内联存放，构造时会被拒绝
+        static _Fn *_S_get(void *__p) noexcept {
+            return std::launder(static_cast<_Fn *>(__p));
+        }
+
+        static constexpr std::size_t _S_record_size = _S_header_size + _S_round_up(sizeof(_Fn));
+
+        static std::size_t _S_invoke(void *__p, std::add_lvalue_reference_t<_Args> ...__args) {
+            std::invoke(*_S_get(__p), __args...);
+            return _S_record_size;
+        }
+
+        static void _S_move(void *__dst, void *__src) noexcept {
+            _Fn *__f = _S_get(__src);
+            ::new (__dst) _Fn(std::move(*__f));
+            __f->~_Fn();
+        }
+
+        static void _S_destroy(void *__p) noexcept {
+            _S_get(__p)->~_Fn();
+        }
+
+        static constexpr _FuncOps _S_ops = {
+            _S_record_size,
+            std::is_trivially_copyable_v<_Fn> ? nullptr : _S_move,
+            std::is_trivially_destructible_v<_Fn> ? nullptr : _S_destroy,
+        };
+    };
+
+    unsigned char *_M_data;
+    std::size_t _M_bytes; // 已使用的字节数
+    std::size_t _M_cap;   // 已分配的字节数
+    std::size_t _M_count; // 仿函数个数
+
+    static _Header *_S_header(unsigned char *__rec) noexcept {
+        return reinterpret_cast<_Header *>(__rec);
+    }
+
+    static void *_S_payload(unsigned char *__rec) noexcept {
+        return __rec + _S_header_size;
+    }
+
+    static unsigned char *_S_allocate(std::size_t __n) {
+        return static_cast<unsigned char *>(::operator new(__n, std::align_val_t(_S_align)));
+    }
+
+    static void _S_deallocate(unsigned char *__p) noexcept {
+        if (__p)
+            ::operator delete(__p, std::align_val_t(_S_align));
+    }
+
+    // 逐条把记录搬到已分配好的新内存，可平凡拷贝的仿函数直接按字节拷贝；emplace_back 保证仿函数的移动不抛异常
+    void _M_relocate(unsigned char *__new_data, std::size_t __new_cap) noexcept {
+        for (std::size_t __off = 0; __off < _M_bytes; ) {
+            unsigned char *__src = _M_data + __off;
+            unsigned char *__dst = __new_data + __off;
+            _FuncOps const *__ops = _S_header(__src)->_M_ops;
+            if (__ops->_M_move) {
+                ::new (static_cast<void *>(__dst)) _Header(*_S_header(__src));
+                __ops->_M_move(_S_payload(__dst), _S_payload(__src));
+            } else {
+                std::memcpy(__dst, __src, __ops->_M_record_size);
+            }
+            __off += __ops->_M_record_size;
+        }
+        _S_deallocate(_M_data);
+        _M_data = __new_data;
+        _M_cap = __new_cap;
+    }
+
+    void _M_relocate(std::size_t __new_cap) {
+        _M_relocate(_S_allocate(__new_cap), __new_cap);
+    }
+
+public:
+    InplaceFunctionVector() noexcept : _M_data(nullptr), _M_bytes(0), _M_cap(0), _M_count(0) {}
+
+    InplaceFunctionVector(InplaceFunctionVector &&__that) noexcept
+        : _M_data(std::exchange(__that._M_data, nullptr))
+        , _M_bytes(std::exchange(__that._M_bytes, 0))
+        , _M_cap(std::exchange(__that._M_cap, 0))
+        , _M_count(std::exchange(__that._M_count, 0)) {}
+
+    InplaceFunctionVector &operator=(InplaceFunctionVector &&__that) noexcept {
+        if (this != &__that) [[likely]] {
+            clear();
+            _S_deallocate(_M_data);
+            _M_data = std::exchange(__that._M_data, nullptr);
+            _M_bytes = std::exchange(__that._M_bytes, 0);
+            _M_cap = std::exchange(__that._M_cap, 0);
+            _M_count = std::exchange(__that._M_count, 0);
+        }
+        return *this;
+    }
+
+    InplaceFunctionVector(InplaceFunctionVector const &) = delete;
+    InplaceFunctionVector &operator=(InplaceFunctionVector const &) = delete;
+
+    ~InplaceFunctionVector() noexcept {
+        clear();
+        _S_deallocate(_M_data);
+    }
+
+    std::size_t size() const noexcept {
+        return _M_count;
+    }
+
+    bool empty() const noexcept {
+        return _M_count == 0;
+    }
+
+    // 已使用与已分配的字节数
+    std::size_t bytes() const noexcept {
+        return _M_bytes;
+    }
+
+    std::size_t capacity() const noexcept {
+        return _M_cap;
+    }
+
+    void reserve(std::size_t __bytes) {
+        if (__bytes > _M_cap)
+            _M_relocate(_S_round_up(__bytes));
+    }
+
+    void clear() noexcept {
+        for (std::size_t __off = 0; __off < _M_bytes; ) {
+            unsigned char *__rec = _M_data + __off;
+            _FuncOps const *__ops = _S_header(__rec)->_M_ops;
+            if (__ops->_M_destroy)
+                __ops->_M_destroy(_S_payload(__rec));
+            __off += __ops->_M_record_size;
+        }
+        _M_bytes = 0;
+        _M_count = 0;
+    }
+
+    template <class _Fn, class ..._CArgs>
+    std::decay_t<_Fn> &emplace_back(_CArgs &&...__args) {
+        using _Impl = _FuncImpl<_Fn>;
+        static_assert(alignof(_Fn) <= _S_align, "over-aligned callables cannot be stored inline");
+        static_assert(std::is_invocable_v<_Fn &, std::add_lvalue_reference_t<_Args>...>, "callable does not match the signature");
+        static_assert(std::is_nothrow_move_constructible_v<_Fn>, "callables are relocated on growth and must be nothrow move constructible");
+        std::size_t __need = _Impl::_S_ops._M_record_size;
+        unsigned char *__rec;
+        _Fn *__f;
+        if (_M_bytes + __need > _M_cap) {
+            // 同 std::vector：先在新内存中构造新元素，再搬移旧记录，参数引用了已有的仿函数也不会失效
+            std::size_t __new_cap = std::max(_M_cap * 2, _M_bytes + __need);
+            unsigned char *__new_data = _S_allocate(__new_cap);
+            __rec = __new_data + _M_bytes;
+            try {
+                __f = ::new (_S_payload(__rec)) _Fn(std::forward<_CArgs>(__args)...);
+            } catch (...) {
+                _S_deallocate(__new_data);
+                throw;
+            }
+            _M_relocate(__new_data, __new_cap);
+        } else {
+            __rec = _M_data + _M_bytes;
+            __f = ::new (_S_payload(__rec)) _Fn(std::forward<_CArgs>(__args)...);
+        }
+        ::new (static_cast<void *>(__rec)) _Header{_Impl::_S_invoke, &_Impl::_S_ops};
+        _M_bytes += __need;
+        ++_M_count;
+        return *__f;
+    }
+
+    template <class _Fn>
+    std::decay_t<_Fn> &push_back(_Fn &&__f) {
+        return emplace_back<std::decay_t<_Fn>>(std::forward<_Fn>(__f));
+    }
+
+    // 按插入顺序依次调用所有仿函数
+    void invoke_all(_Args ...__args) {
+        unsigned char *__rec = _M_data;
+        unsigned char *__end = _M_data + _M_bytes;
+        while (__rec != __end) {
+            __rec += _S_header(__rec)->_M_invoke(_S_payload(__rec), __args...);
+        }
+    }
+};
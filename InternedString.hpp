@@ -0,0 +1,278 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include "String.hpp"
+#include "Vector.hpp"
+
+// 驻留字符串：内容相同的 InternedString 全局只存一份，共享同一个不可变的块
+// 块中依次存放引用计数、哈希值、长度和字符内容，一次分配完成（同 SharedPtr.hpp 中 makeShared 的 _SpCounterImplFused 思路）
+// 因此相等比较只需比较指针，哈希值直接读取预先算好的
+
+struct _InternedStringRep {
+    std::atomic<long> _M_refcnt;
+    std::size_t _M_hash;
+    std::size_t _M_size;
+    _InternedStringRep *_M_next; // 驻留表中同一个桶里的下一个块
+
+    char *_M_data() noexcept {
+        return reinterpret_cast<char *>(this + 1);
+    }
+
+    bool _M_equal(std::size_t __hash, char const *__s, std::size_t __n) noexcept {
+        return _M_hash == __hash && _M_size == __n && std::memcmp(_M_data(), __s, __n) == 0;
+    }
+
+    bool _M_try_incref() noexcept { // 计数已经归零的块正在被销毁，不能再“复活”
+        long __cnt = _M_refcnt.load(std::memory_order_relaxed);
+        while (__cnt != 0) {
+            if (_M_refcnt.compare_exchange_weak(__cnt, __cnt + 1, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+};
+
+// 全局驻留表：按哈希值高位分成若干分片，每个分片各自加锁，减少多线程同时驻留时的争用
+// 每个分片是一个拉链法哈希表，链表指针直接存在块里，不需要额外分配节点
+struct _InternTable {
+    static constexpr std::size_t _S_shard_count = 16;
+
+    struct _Shard {
+        std::mutex _M_mutex;
+        Vector<_InternedStringRep *> _M_buckets;
+        std::size_t _M_count = 0;
+
+        _Shard() : _M_buckets(64) {}
+
+        _InternedStringRep *&_M_bucket(std::size_t __hash) noexcept {
+            return _M_buckets[__hash & (_M_buckets.size() - 1)];
+        }
+
+        void _M_rehash() {
+            Vector<_InternedStringRep *> __old(std::move(_M_buckets));
+            _M_buckets = Vector<_InternedStringRep *>(__old.size() * 2);
+            for (_InternedStringRep *__rep : __old) {
+                while (__rep) {
+                    _InternedStringRep *__next = __rep->_M_next;
+                    _InternedStringRep *&__head = _M_bucket(__rep->_M_hash);
+                    __rep->_M_next = __head;
+                    __head = __rep;
+                    __rep = __next;
+                }
+            }
+        }
+    };
+
+    _Shard _M_shards[_S_shard_count];
+
+    static _InternTable &_S_instance() {
+        // 故意泄漏：保证其他静态对象中的 InternedString 析构时驻留表依然有效
+        static _InternTable *__table = new _InternTable;
+        return *__table;
+    }
+
+    static _Shard &_S_shard_of(std::size_t __hash) noexcept {
+        return _S_instance()._M_shards[(__hash >> (sizeof(std::size_t) * 8 - 4)) % _S_shard_count];
+    }
+
+    static _InternedStringRep *_S_intern(char const *__s, std::size_t __n) {
+        std::size_t __hash = std::hash<std::string_view>()(std::string_view(__s, __n));
+        _Shard &__shard = _S_shard_of(__hash);
+        std::lock_guard<std::mutex> __lock(__shard._M_mutex);
+        for (_InternedStringRep *__rep = __shard._M_bucket(__hash); __rep; __rep = __rep->_M_next) {
+            if (__rep->_M_equal(__hash, __s, __n) && __rep->_M_try_incref())
+                return __rep;
+        }
+        if (__shard._M_count >= __shard._M_buckets.size())
+            __shard._M_rehash();
+        void *__mem = ::operator new(sizeof(_InternedStringRep) + __n + 1);
+        _InternedStringRep *__rep = new (__mem) _InternedStringRep{{1}, __hash, __n, nullptr};
+        std::memcpy(__rep->_M_data(), __s, __n);
+        __rep->_M_data()[__n] = '\0';
+        _InternedStringRep *&__head = __shard._M_bucket(__hash);
+        __rep->_M_next = __head;
+        __head = __rep;
+        ++__shard._M_count;
+        return __rep;
+    }
+
+    static void _S_release(_InternedStringRep *__rep) noexcept {
+        _Shard &__shard = _S_shard_of(__rep->_M_hash);
+        {
+            std::lock_guard<std::mutex> __lock(__shard._M_mutex);
+            _InternedStringRep **__link = &__shard._M_bucket(__rep->_M_hash);
+            while (*__link != __rep)
+                __link = &(*__link)->_M_next;
+            *__link = __rep->_M_next;
+            --__shard._M_count;
+        }
+        __rep->~_InternedStringRep();
+        ::operator delete(__rep);
+    }
+};
+
+struct InternedString {
+private:
+    _InternedStringRep *_M_rep; // 空字符串用 nullptr 表示，不进驻留表
+
+    void _M_incref() const noexcept {
+        if (_M_rep)
+            _M_rep->_M_refcnt.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void _M_decref() const noexcept {
+        if (_M_rep && _M_rep->_M_refcnt.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            _InternTable::_S_release(_M_rep);
+    }
+
+public:
+    using value_type = char;
+    using size_type = std::size_t;
+    using const_iterator = char const *;
+    using iterator = const_iterator;
+
+    InternedString() noexcept : _M_rep(nullptr) {}
+
+    explicit InternedString(std::string_view __sv)
+        : _M_rep(__sv.empty() ? nullptr : _InternTable::_S_intern(__sv.data(), __sv.size())) {}
+
+    explicit InternedString(char const *__s) : InternedString(std::string_view(__s)) {}
+
+    explicit InternedString(String const &__s) : InternedString(std::string_view(__s)) {}
+
+    InternedString(InternedString const &__that) noexcept : _M_rep(__that._M_rep) {
+        _M_incref();
+    }
+
+    InternedString(InternedString &&__that) noexcept : _M_rep(__that._M_rep) {
+        __that._M_rep = nullptr;
+    }
+
+    InternedString &operator=(InternedString const &__that) noexcept {
+        __that._M_incref();
+        _M_decref();
+        _M_rep = __that._M_rep;
+        return *this;
+    }
+
+    InternedString &operator=(InternedString &&__that) noexcept {
+        if (this != &__that) [[likely]] {
+            _M_decref();
+            _M_rep = __that._M_rep;
+            __that._M_rep = nullptr;
+        }
+        return *this;
+    }
+
+    ~InternedString() noexcept {
+        _M_decref();
+    }
+
+    std::size_t size() const noexcept {
+        return _M_rep ? _M_rep->_M_size : 0;
+    }
+
+    bool empty() const noexcept {
+        return _M_rep == nullptr;
+    }
+
+    char const *data() const noexcept {
+        return _M_rep ? _M_rep->_M_data() : "";
+    }
+
+    char const *c_str() const noexcept {
+        return data();
+    }
+
+    char const *begin() const noexcept {
+        return data();
+    }
+
+    char const *end() const noexcept {
+        return data() + size();
+    }
+
+    char operator[](std::size_t __i) const noexcept {
+        return data()[__i];
+    }
+
+    operator std::string_view() const noexcept {
+        return std::string_view(data(), size());
+    }
+
+    String str() const {
+        return String(data(), size());
+    }
+
+    // 哈希值在驻留时已算好，与 std::hash<std::string_view> 的结果一致
+    std::size_t hash() const noexcept {
+        return _M_rep ? _M_rep->_M_hash : std::hash<std::string_view>()(std::string_view());
+    }
+
+    long use_count() const noexcept {
+        return _M_rep ? _M_rep->_M_refcnt.load(std::memory_order_relaxed) : 0;
+    }
+
+    void swap(InternedString &__that) noexcept {
+        std::swap(_M_rep, __that._M_rep);
+    }
+
+    // 内容相同必然是同一个块，比较指针即可
+    bool operator==(InternedString const &__that) const noexcept {
+        return _M_rep == __that._M_rep;
+    }
+
+    bool operator!=(InternedString const &__that) const noexcept {
+        return _M_rep != __that._M_rep;
+    }
+
+    // 按字典序比较，结果与 std::string_view 一致；同一个块时直接判定相等
+    int compare(InternedString const &__that) const noexcept {
+        if (_M_rep == __that._M_rep)
+            return 0;
+        return std::string_view(*this).compare(std::string_view(__that));
+    }
+
+    bool operator<(InternedString const &__that) const noexcept {
+        return compare(__that) < 0;
+    }
+
+    bool operator>(InternedString const &__that) const noexcept {
+        return compare(__that) > 0;
+    }
+
+    bool operator<=(InternedString const &__that) const noexcept {
+        return compare(__that) <= 0;
+    }
+
+    bool operator>=(InternedString const &__that) const noexcept {
+        return compare(__that) >= 0;
+    }
+
+    // 按块地址排序，只需一次指针比较，适合不关心遍历顺序的 Map<InternedString, ...>
+    // 注意：顺序取决于内存分配，每次运行可能不同
+    struct IdentityLess {
+        bool operator()(InternedString const &__lhs, InternedString const &__rhs) const noexcept {
+            return std::less<_InternedStringRep *>()(__lhs._M_rep, __rhs._M_rep);
+        }
+    };
+
+    friend std::ostream &operator<<(std::ostream &__os, InternedString const &__s) {
+        return __os << std::string_view(__s);
+    }
+};
+
+template <>
+struct std::hash<InternedString> {
+    std::size_t operator()(InternedString const &__s) const noexcept {
+        return __s.hash();
+    }
+};
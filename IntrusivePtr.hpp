@@ -0,0 +1,207 @@
+#pragma once
+
+#include "SharedPtr.hpp"
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+template <class _Tp>
+struct IntrusivePtr;
+
+// CRTP：引用计数直接放在对象里，IntrusivePtr 只需要一个指针，没有单独的控制块
+// _Policy 与 SharedPtr 相同：_SpAtomicPolicy 可以跨线程共享，_SpLocalPolicy 只在一个线程内使用但拷贝更快
+// 计数归零时通过 IntrusivePtr<T> 的 T 来 delete，所以经由基类指针持有子类对象时，基类需要有虚析构函数
+template <class _Tp, class _Policy = _SpAtomicPolicy>
+struct IntrusiveRefCounted {
+private:
+    mutable typename _Policy::_Count _M_refcnt;
+
+    template <class>
+    friend struct IntrusivePtr;
+
+    void _M_incref() const noexcept {
+        _Policy::_S_inc(_M_refcnt);
+    }
+
+    bool _M_decref() const noexcept { // 返回 true 表示计数已归零，调用者负责析构对象
+        if (_Policy::_S_dec(_M_refcnt) == 1) {
+            _Policy::_S_acquire(_M_refcnt);
+            return true;
+        }
+        return false;
+    }
+
+protected:
+    IntrusiveRefCounted() noexcept : _M_refcnt(0) {}
+
+    // 拷贝出来的是一个新对象，计数从 0 开始
+    IntrusiveRefCounted(IntrusiveRefCounted const &) noexcept : _M_refcnt(0) {}
+
+    IntrusiveRefCounted &operator=(IntrusiveRefCounted const &) noexcept {
+        return *this;
+    }
+
+    ~IntrusiveRefCounted() = default;
+
+public:
+    long use_count() const noexcept {
+        return _Policy::_S_load(_M_refcnt);
+    }
+};
+
+template <class _Tp>
+struct IntrusivePtr {
+private:
+    _Tp *_M_ptr;
+
+    template <class>
+    friend struct IntrusivePtr;
+
+    static void _S_release(_Tp *__ptr) noexcept {
+        if (__ptr && __ptr->_M_decref()) {
+            DefaultDeleter<_Tp>()(__ptr);
+        }
+    }
+
+public:
+    using element_type = _Tp;
+    using pointer = _Tp *;
+
+    IntrusivePtr(std::nullptr_t = nullptr) noexcept : _M_ptr(nullptr) {}
+
+    // 计数在对象里，所以同一个裸指针可以多次交给 IntrusivePtr，不会像 SharedPtr 那样重复释放
+    // __add_ref 为 false 时接管一个已经计过数的引用，与 release() 配对使用
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    explicit IntrusivePtr(_Yp *__ptr, bool __add_ref = true) noexcept : _M_ptr(__ptr) {
+        if (_M_ptr && __add_ref) {
+            _M_ptr->_M_incref();
+        }
+    }
+
+    IntrusivePtr(IntrusivePtr const &__that) noexcept : _M_ptr(__that._M_ptr) {
+        if (_M_ptr) {
+            _M_ptr->_M_incref();
+        }
+    }
+
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    IntrusivePtr(IntrusivePtr<_Yp> const &__that) noexcept : _M_ptr(__that._M_ptr) {
+        if (_M_ptr) {
+            _M_ptr->_M_incref();
+        }
+    }
+
+    IntrusivePtr(IntrusivePtr &&__that) noexcept : _M_ptr(std::exchange(__that._M_ptr, nullptr)) {}
+
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    IntrusivePtr(IntrusivePtr<_Yp> &&__that) noexcept : _M_ptr(std::exchange(__that._M_ptr, nullptr)) {}
+
+    // 先增加新对象的计数再释放旧对象，自我赋值或 *this 持有 __that 的唯一引用时也安全
+    IntrusivePtr &operator=(IntrusivePtr const &__that) noexcept {
+        IntrusivePtr(__that).swap(*this);
+        return *this;
+    }
+
+    IntrusivePtr &operator=(IntrusivePtr &&__that) noexcept {
+        IntrusivePtr(std::move(__that)).swap(*this);
+        return *this;
+    }
+
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    IntrusivePtr &operator=(IntrusivePtr<_Yp> const &__that) noexcept {
+        IntrusivePtr(__that).swap(*this);
+        return *this;
+    }
+
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    IntrusivePtr &operator=(IntrusivePtr<_Yp> &&__that) noexcept {
+        IntrusivePtr(std::move(__that)).swap(*this);
+        return *this;
+    }
+
+    ~IntrusivePtr() noexcept {
+        _S_release(_M_ptr);
+    }
+
+    void reset() noexcept {
+        _S_release(std::exchange(_M_ptr, nullptr));
+    }
+
+    template <class _Yp>
+    void reset(_Yp *__ptr, bool __add_ref = true) noexcept {
+        IntrusivePtr(__ptr, __add_ref).swap(*this);
+    }
+
+    // 放弃所有权但不减少计数，之后需要用 IntrusivePtr(p, false) 接管回来
+    _Tp *release() noexcept {
+        return std::exchange(_M_ptr, nullptr);
+    }
+
+    long use_count() const noexcept {
+        return _M_ptr ? _M_ptr->use_count() : 0;
+    }
+
+    bool unique() const noexcept {
+        return use_count() == 1;
+    }
+
+    template <class _Yp>
+    bool operator==(IntrusivePtr<_Yp> const &__that) const noexcept {
+        return _M_ptr == __that._M_ptr;
+    }
+
+    template <class _Yp>
+    bool operator!=(IntrusivePtr<_Yp> const &__that) const noexcept {
+        return _M_ptr != __that._M_ptr;
+    }
+
+    template <class _Yp>
+    bool operator<(IntrusivePtr<_Yp> const &__that) const noexcept {
+        return _M_ptr < __that._M_ptr;
+    }
+
+    void swap(IntrusivePtr &__that) noexcept {
+        std::swap(_M_ptr, __that._M_ptr);
+    }
+
+    _Tp *get() const noexcept {
+        return _M_ptr;
+    }
+
+    _Tp *operator->() const noexcept {
+        return _M_ptr;
+    }
+
+    std::add_lvalue_reference_t<_Tp> operator*() const noexcept {
+        return *_M_ptr;
+    }
+
+    explicit operator bool() const noexcept {
+        return _M_ptr != nullptr;
+    }
+};
+
+template <class _Tp, class... _Args>
+IntrusivePtr<_Tp> makeIntrusive(_Args &&...__args) {
+    return IntrusivePtr<_Tp>(new _Tp(std::forward<_Args>(__args)...));
+}
+
+template <class _Tp, class _Up>
+IntrusivePtr<_Tp> staticPointerCast(IntrusivePtr<_Up> const &__ptr) {
+    return IntrusivePtr<_Tp>(static_cast<_Tp *>(__ptr.get()));
+}
+
+template <class _Tp, class _Up>
+IntrusivePtr<_Tp> constPointerCast(IntrusivePtr<_Up> const &__ptr) {
+    return IntrusivePtr<_Tp>(const_cast<_Tp *>(__ptr.get()));
+}
+
+template <class _Tp, class _Up>
+IntrusivePtr<_Tp> dynamicPointerCast(IntrusivePtr<_Up> const &__ptr) {
+    return IntrusivePtr<_Tp>(dynamic_cast<_Tp *>(__ptr.get()));
+}
@@ -3,6 +3,7 @@
 #include <exception>
 #include <initializer_list>
 #include <type_traits>
+#include "_Common.hpp"
 
 struct BadOptionalAccess : std::exception {
     BadOptionalAccess() = default;
@@ -49,6 +50,15 @@ public:
     explicit Optional(InPlace, std::initializer_list<U> ilist, Ts &&...value_args) : m_has_value(true),
         m_value(ilist, std::forward<Ts>(value_args)...) {}
 
+    // T 满足相应的平凡性时，拷贝、移动与析构也是平凡的，Optional<T> 因此可平凡拷贝，Vector 扩容时可以 memcpy
+    Optional(Optional const &that) requires std::is_trivially_copy_constructible_v<T> = default;
+    Optional(Optional &&that) requires std::is_trivially_move_constructible_v<T> = default;
+    Optional &operator=(Optional const &that) requires (std::is_trivially_copy_constructible_v<T>
+        && std::is_trivially_copy_assignable_v<T> && std::is_trivially_destructible_v<T>) = default;
+    Optional &operator=(Optional &&that) requires (std::is_trivially_move_constructible_v<T>
+        && std::is_trivially_move_assignable_v<T> && std::is_trivially_destructible_v<T>) = default;
+    ~Optional() requires std::is_trivially_destructible_v<T> = default;
+
     Optional(Optional const &that) : m_has_value(that.m_has_value) {
         if (m_has_value) {
             new (&m_value) T(that.m_value); // placement-new（不分配内存，只是构造）
@@ -426,3 +436,8 @@ template <class T>
 Optional<T> makeOptional(T value) {
     return Optional<T>(std::move(value));
 }
+
+// m_has_value 是 Optional 的第一个成员，位于偏移 0 处，同 bool 一样有 254 个空闲取值
+template <class T>
+struct NicheTraits<Optional<T>> : NicheTraits<bool> {
+};
@@ -0,0 +1,445 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include "SharedPtr.hpp"
+#include "UniquePtr.hpp"
+#include "Vector.hpp"
+
+// 无锁数据结构的安全内存回收：节点从结构中摘下后，其他线程可能仍在读它，不能立即释放，只能先 retire 再择机回收
+// EpochDomain（基于纪元）：读者进入临界区只需写一次自己的纪元，开销最小；但长时间停在临界区内的线程会阻止一切回收
+// HazardDomain（风险指针）：读者逐个公布正在访问的指针，每次访问多一次 seq_cst 交换；但未回收的对象数量有上限
+// 两者的 retire(ptr, deleter) 与 SharedPtr 的删除器约定相同，默认使用 DefaultDeleter<T>
+// 内部的“先写后读”顺序全部用 seq_cst 的读-改-写与读取表达，不用单独的 atomic_thread_fence，ThreadSanitizer 能正确理解
+// 相应地，数据结构读取共享指针、摘下节点的 CAS 也应使用 seq_cst（默认的内存序），与域内的操作处在同一个全序中
+
+// 待回收的对象：与 _SpCounterImpl 一样保存指针与删除器，回收时调用删除器并释放自身
+struct _RetiredBase {
+    _RetiredBase *_M_next = nullptr;
+    void const *_M_addr = nullptr;
+
+    virtual void _M_reclaim() noexcept = 0;
+
+    virtual ~_RetiredBase() = default;
+};
+
+template <class _Tp, class _Deleter>
+struct _RetiredImpl final : _RetiredBase {
+    _Tp *_M_ptr;
+    [[no_unique_address]] _Deleter _M_deleter;
+
+    explicit _RetiredImpl(_Tp *__ptr, _Deleter __deleter) noexcept
+        : _M_ptr(__ptr),
+          _M_deleter(std::move(__deleter)) {
+        _M_addr = __ptr;
+    }
+
+    void _M_reclaim() noexcept override {
+        _M_deleter(_M_ptr);
+        delete this;
+    }
+};
+
+// 每个线程私有的待回收链表
+struct _RetiredList {
+    _RetiredBase *_M_head = nullptr;
+    std::size_t _M_size = 0;
+
+    void _M_push(_RetiredBase *__node) noexcept {
+        __node->_M_next = _M_head;
+        _M_head = __node;
+        ++_M_size;
+    }
+
+    // 回收所有满足 __pred 的对象；先把整条链表摘下来，删除器里再次 retire 也不会破坏遍历
+    template <class _Pred>
+    void _M_reclaim_if(_Pred __pred) noexcept {
+        _RetiredBase *__node = std::exchange(_M_head, nullptr);
+        _M_size = 0;
+        _RetiredBase *__dead = nullptr;
+        while (__node) {
+            _RetiredBase *__next = __node->_M_next;
+            if (__pred(__node)) {
+                __node->_M_next = __dead;
+                __dead = __node;
+            } else {
+                _M_push(__node);
+            }
+            __node = __next;
+        }
+        while (__dead) {
+            _RetiredBase *__next = __dead->_M_next;
+            __dead->_M_reclaim();
+            __dead = __next;
+        }
+    }
+
+    void _M_reclaim_all() noexcept {
+        _M_reclaim_if([](_RetiredBase *) { return true; });
+    }
+};
+
+// 域中每个用过它的线程占一条记录，记录挂在无锁链表上只增不删；线程退出时归还，留给之后的线程复用（连同没回收完的对象）
+// 域销毁时不能再有线程在使用它，此时回收全部剩余对象并释放所有记录
+template <class _Record>
+struct _ReclaimRegistry {
+    std::atomic<_Record *> _M_head{nullptr};
+
+    _ReclaimRegistry() = default;
+
+    _ReclaimRegistry(_ReclaimRegistry &&) = delete;
+
+    ~_ReclaimRegistry() noexcept {
+        _Record *__rec = _M_head.load(std::memory_order_acquire);
+        while (__rec) {
+            _Record *__next = __rec->_M_next;
+            __rec->_M_reclaim_all();
+            delete __rec;
+            __rec = __next;
+        }
+    }
+
+    _Record *_M_acquire() {
+        for (_Record *__rec = _M_head.load(std::memory_order_acquire); __rec; __rec = __rec->_M_next) {
+            bool __expected = false;
+            if (!__rec->_M_in_use.load(std::memory_order_relaxed) &&
+                __rec->_M_in_use.compare_exchange_strong(__expected, true, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return __rec;
+            }
+        }
+        _Record *__rec = new _Record;
+        __rec->_M_in_use.store(true, std::memory_order_relaxed);
+        _Record *__head = _M_head.load(std::memory_order_relaxed);
+        do {
+            __rec->_M_next = __head;
+        } while (!_M_head.compare_exchange_weak(__head, __rec, std::memory_order_release, std::memory_order_relaxed));
+        return __rec;
+    }
+};
+
+// 当前线程在各个域中的记录；只持有域的 WeakPtr，域先于线程销毁时不会访问已释放的记录
+template <class _Registry>
+struct _ReclaimThreadSlots {
+private:
+    using _Record = typename _Registry::_Record;
+
+    struct _Slot {
+        _Registry const *_M_key;
+        WeakPtr<_Registry> _M_registry;
+        _Record *_M_record;
+    };
+
+    Vector<_Slot> _M_slots;
+
+public:
+    _ReclaimThreadSlots() = default;
+
+    _ReclaimThreadSlots(_ReclaimThreadSlots &&) = delete;
+
+    ~_ReclaimThreadSlots() noexcept {
+        for (_Slot &__slot: _M_slots) {
+            if (SharedPtr<_Registry> __reg = __slot._M_registry.lock()) {
+                __slot._M_record->_M_detach();
+            }
+        }
+    }
+
+    static _Record *_S_get(SharedPtr<_Registry> const &__reg) {
+        thread_local _ReclaimThreadSlots __self;
+        Vector<_Slot> &__slots = __self._M_slots;
+        for (std::size_t __i = 0; __i < __slots.size(); ++__i) {
+            if (__slots[__i]._M_key == __reg.get()) {
+                if (!__slots[__i]._M_registry.expired()) {
+                    return __slots[__i]._M_record;
+                }
+                // 同一地址上的旧域已经销毁，丢弃这条过期记录
+                __slots.erase(__slots.begin() + __i);
+                break;
+            }
+        }
+        _Record *__rec = __reg->_M_acquire();
+        __slots.push_back(_Slot{__reg.get(), WeakPtr<_Registry>(__reg), __rec});
+        return __rec;
+    }
+};
+
+// 基于纪元的回收（Fraser, Practical lock-freedom）：全局纪元只在所有处于临界区的线程都已观察到它时才前进
+// 在纪元 e retire 的对象，等全局纪元到达 e + 2 时，已没有线程可能还持有它
+struct EpochDomain {
+private:
+    struct _Record {
+        _Record *_M_next = nullptr;
+        std::atomic<bool> _M_in_use{false};
+        std::atomic<std::uint64_t> _M_state{0}; // 在临界区内时为 (纪元 << 1) | 1，否则为 0
+        unsigned _M_nesting = 0;
+        std::size_t _M_since_collect = 0;
+        std::uint64_t _M_collect_epoch = 0; // 上一次 collect 时的纪元
+        // 按 retire 时的纪元分成三桶，_M_limbo[e % 3] 存放纪元 _M_limbo_epoch[e % 3] 中 retire 的对象
+        // 回收时整桶释放，不必逐个检查，纪元暂时推进不了时也不会反复扫描
+        _RetiredList _M_limbo[3];
+        std::uint64_t _M_limbo_epoch[3] = {};
+
+        // 回收所有 retire 纪元不晚于 __epoch - 2 的桶
+        void _M_reclaim(std::uint64_t __epoch) noexcept {
+            for (std::size_t __i = 0; __i < 3; ++__i) {
+                if (_M_limbo[__i]._M_head && _M_limbo_epoch[__i] + 2 <= __epoch) {
+                    _M_limbo[__i]._M_reclaim_all();
+                }
+            }
+        }
+
+        void _M_reclaim_all() noexcept {
+            for (auto &__limbo: _M_limbo) {
+                __limbo._M_reclaim_all();
+            }
+        }
+
+        void _M_detach() noexcept {
+            _M_nesting = 0;
+            _M_state.store(0, std::memory_order_release);
+            _M_in_use.store(false, std::memory_order_release);
+        }
+    };
+
+    struct _Registry : _ReclaimRegistry<_Record> {
+        using _Record = EpochDomain::_Record;
+
+        alignas(64) std::atomic<std::uint64_t> _M_epoch{0};
+    };
+
+    SharedPtr<_Registry> _M_registry;
+
+    static constexpr std::size_t _S_collect_threshold = 64; // 本线程每 retire 这么多个对象尝试推进一次纪元
+
+    _Record *_M_record() {
+        return _ReclaimThreadSlots<_Registry>::_S_get(_M_registry);
+    }
+
+    // 所有在临界区内的线程都已观察到当前纪元时推进一步，返回推进后（或未能推进时当前）的纪元
+    // 读取各线程状态用 seq_cst：与 pin 的交换处在同一全序中，同时带有 acquire，读者在临界区内的访问都发生在此之前
+    std::uint64_t _M_try_advance() noexcept {
+        std::uint64_t __epoch = _M_registry->_M_epoch.load(std::memory_order_seq_cst);
+        for (_Record *__rec = _M_registry->_M_head.load(std::memory_order_acquire); __rec; __rec = __rec->_M_next) {
+            std::uint64_t __state = __rec->_M_state.load(std::memory_order_seq_cst);
+            if ((__state & 1) && (__state >> 1) != __epoch) {
+                return __epoch;
+            }
+        }
+        // 推进同样是 seq_cst：之后读到新纪元并据此回收的线程，也就同步了上面读到的各线程状态
+        if (_M_registry->_M_epoch.compare_exchange_strong(__epoch, __epoch + 1, std::memory_order_seq_cst, std::memory_order_seq_cst)) {
+            ++__epoch;
+        }
+        return __epoch;
+    }
+
+    void _M_collect(_Record *__rec) noexcept {
+        std::uint64_t __epoch = _M_try_advance();
+        // 纪元没有前进（多半是别的线程刚推进过，还有线程没跟上）时，下一次 retire 就再试，而不是再等满一轮
+        if (__epoch != __rec->_M_collect_epoch) {
+            __rec->_M_collect_epoch = __epoch;
+            __rec->_M_since_collect = 0;
+        }
+        __rec->_M_reclaim(__epoch);
+    }
+
+public:
+    // 临界区：Guard 存在期间从共享结构中读到的节点都不会被回收，可以嵌套
+    struct Guard {
+    private:
+        _Record *_M_rec;
+
+        friend struct EpochDomain;
+
+        explicit Guard(_Record *__rec) noexcept : _M_rec(__rec) {}
+
+    public:
+        Guard(Guard &&) = delete;
+
+        ~Guard() noexcept {
+            if (--_M_rec->_M_nesting == 0) {
+                _M_rec->_M_state.store(0, std::memory_order_release);
+            }
+        }
+    };
+
+    EpochDomain() : _M_registry(makeShared<_Registry>()) {}
+
+    EpochDomain(EpochDomain &&) = delete;
+
+    [[nodiscard]] Guard pin() {
+        _Record *__rec = _M_record();
+        if (__rec->_M_nesting++ == 0) {
+            // 用交换而不是 store + fence 公布状态：seq_cst 的读-改-写保证之后读取共享指针时，推进纪元的线程已能看到本线程在临界区内
+            std::uint64_t __epoch = _M_registry->_M_epoch.load(std::memory_order_seq_cst);
+            __rec->_M_state.exchange((__epoch << 1) | 1, std::memory_order_seq_cst);
+        }
+        return Guard(__rec);
+    }
+
+    // __ptr 必须已经从共享结构中摘下，之后不会再有线程新读到它
+    template <class _Tp, class _Deleter = DefaultDeleter<_Tp>>
+    void retire(_Tp *__ptr, _Deleter __deleter = _Deleter()) {
+        _Record *__rec = _M_record();
+        _RetiredBase *__node = new _RetiredImpl<_Tp, _Deleter>(__ptr, std::move(__deleter));
+        // 读到的纪元只可能偏旧，那只会让对象晚一些回收；读到新纪元则同步了推进它的线程
+        std::uint64_t __epoch = _M_registry->_M_epoch.load(std::memory_order_seq_cst);
+        std::size_t __bucket = __epoch % 3;
+        if (__rec->_M_limbo_epoch[__bucket] != __epoch) {
+            // 桶里是至少三个纪元之前的对象，早已安全
+            __rec->_M_limbo[__bucket]._M_reclaim_all();
+            __rec->_M_limbo_epoch[__bucket] = __epoch;
+        }
+        __rec->_M_limbo[__bucket]._M_push(__node);
+        if (++__rec->_M_since_collect >= _S_collect_threshold) {
+            _M_collect(__rec);
+        }
+    }
+
+    // 尝试推进纪元，并回收本线程 retire 过的、已经安全的对象
+    void collect() {
+        _Record *__rec = _M_record();
+        __rec->_M_reclaim(_M_try_advance());
+    }
+
+    std::uint64_t epoch() const noexcept {
+        return _M_registry->_M_epoch.load(std::memory_order_relaxed);
+    }
+};
+
+// 风险指针（Michael, Hazard Pointers: Safe Memory Reclamation for Lock-Free Objects）
+// 读者把要访问的指针写入自己的风险指针槽，回收时跳过所有槽中出现的地址
+struct HazardDomain {
+    static constexpr std::size_t slots_per_thread = 8;
+
+private:
+    struct _Record {
+        _Record *_M_next = nullptr;
+        std::atomic<bool> _M_in_use{false};
+        std::atomic<void const *> _M_hazards[slots_per_thread] = {};
+        unsigned _M_used = 0; // 哪些槽已被 HazardPointer 占用，只有所属线程访问
+        _RetiredList _M_retired;
+
+        void _M_reclaim_all() noexcept {
+            _M_retired._M_reclaim_all();
+        }
+
+        void _M_detach() noexcept {
+            for (auto &__hazard: _M_hazards) {
+                __hazard.store(nullptr, std::memory_order_release);
+            }
+            _M_used = 0;
+            _M_in_use.store(false, std::memory_order_release);
+        }
+    };
+
+    struct _Registry : _ReclaimRegistry<_Record> {
+        using _Record = HazardDomain::_Record;
+    };
+
+    SharedPtr<_Registry> _M_registry;
+
+    // 本线程积累多少个待回收对象后扫描一次；最多 slots_per_thread * 线程数 个对象因被保护而留下
+    static constexpr std::size_t _S_scan_threshold = 64;
+
+    _Record *_M_record() {
+        return _ReclaimThreadSlots<_Registry>::_S_get(_M_registry);
+    }
+
+    // 风险指针用 seq_cst 读取：与摘下节点的 CAS、protect 的交换处在同一全序中，不会错过已公布的指针
+    void _M_scan(_Record *__rec) {
+        Vector<void const *> __protected;
+        for (_Record *__r = _M_registry->_M_head.load(std::memory_order_acquire); __r; __r = __r->_M_next) {
+            for (auto &__hazard: __r->_M_hazards) {
+                if (void const *__p = __hazard.load(std::memory_order_seq_cst)) {
+                    __protected.push_back(__p);
+                }
+            }
+        }
+        std::sort(__protected.begin(), __protected.end());
+        __rec->_M_retired._M_reclaim_if([&](_RetiredBase *__node) {
+            return !std::binary_search(__protected.begin(), __protected.end(), __node->_M_addr);
+        });
+    }
+
+public:
+    // 一个风险指针槽：protect 返回的指针在 reset、再次 protect 或析构之前不会被回收
+    struct HazardPointer {
+    private:
+        _Record *_M_rec;
+        unsigned _M_index;
+
+        friend struct HazardDomain;
+
+        explicit HazardPointer(_Record *__rec, unsigned __index) noexcept
+            : _M_rec(__rec),
+              _M_index(__index) {}
+
+    public:
+        HazardPointer(HazardPointer &&__that) noexcept
+            : _M_rec(std::exchange(__that._M_rec, nullptr)),
+              _M_index(__that._M_index) {}
+
+        HazardPointer &operator=(HazardPointer &&) = delete;
+
+        ~HazardPointer() noexcept {
+            if (_M_rec) {
+                reset();
+                _M_rec->_M_used &= ~(1u << _M_index);
+            }
+        }
+
+        // 读取 __src 并公布，再确认 __src 没有改变：确认之后才能保证该对象尚未被 retire
+        // 公布与确认都是 seq_cst，公布一定先于确认对回收线程可见
+        template <class _Tp>
+        _Tp *protect(std::atomic<_Tp *> const &__src) noexcept {
+            _Tp *__ptr = __src.load(std::memory_order_relaxed);
+            for (;;) {
+                _M_rec->_M_hazards[_M_index].exchange(__ptr, std::memory_order_seq_cst);
+                _Tp *__again = __src.load(std::memory_order_seq_cst);
+                if (__again == __ptr) {
+                    return __ptr;
+                }
+                __ptr = __again;
+            }
+        }
+
+        void reset() noexcept {
+            _M_rec->_M_hazards[_M_index].store(nullptr, std::memory_order_release);
+        }
+    };
+
+    HazardDomain() : _M_registry(makeShared<_Registry>()) {}
+
+    HazardDomain(HazardDomain &&) = delete;
+
+    // 每个线程同时最多持有 slots_per_thread 个，超出时抛出 std::length_error
+    [[nodiscard]] HazardPointer make_hazard() {
+        _Record *__rec = _M_record();
+        for (unsigned __i = 0; __i < slots_per_thread; ++__i) {
+            if (!(__rec->_M_used & (1u << __i))) {
+                __rec->_M_used |= 1u << __i;
+                return HazardPointer(__rec, __i);
+            }
+        }
+        throw std::length_error("HazardDomain::make_hazard: too many hazard pointers in this thread");
+    }
+
+    // __ptr 必须已经从共享结构中摘下，之后不会再有线程新读到它
+    template <class _Tp, class _Deleter = DefaultDeleter<_Tp>>
+    void retire(_Tp *__ptr, _Deleter __deleter = _Deleter()) {
+        _Record *__rec = _M_record();
+        __rec->_M_retired._M_push(new _RetiredImpl<_Tp, _Deleter>(__ptr, std::move(__deleter)));
+        if (__rec->_M_retired._M_size >= _S_scan_threshold) {
+            _M_scan(__rec);
+        }
+    }
+
+    // 立即扫描一次，回收本线程 retire 过的、没有被任何风险指针保护的对象
+    void collect() {
+        _M_scan(_M_record());
+    }
+};
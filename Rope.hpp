@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include "String.hpp"
+#include "SharedPtr.hpp"
+#include "Vector.hpp"
+#include "_Common.hpp"
+
+// 绳索（Rope）：把长字符串切成若干 String 块，挂在一棵平衡二叉树的叶子上
+// 内部节点只记录左右子树与总长度，因此按下标定位、在任意位置插入删除都只需走一条树枝，复杂度 O(log n)
+// 节点一经创建便不再修改，修改操作只复制走过的那条树枝，其余子树通过 SharedPtr 共享
+// 所以拷贝 Rope 是 O(1) 的，同一段模板文本被拼接多次也只占一份内存
+// 平衡采用 AVL 的规则：任意内部节点左右子树的高度差不超过 1
+
+struct _RopeNode {
+    std::size_t _M_size;       // 子树中的字符总数
+    unsigned _M_height;        // 叶子为 0
+    SharedPtr<_RopeNode> _M_left;  // 叶子的左右子树为空
+    SharedPtr<_RopeNode> _M_right;
+    String _M_chunk;           // 只有叶子使用
+
+    bool _M_is_leaf() const noexcept {
+        return _M_height == 0;
+    }
+};
+
+struct Rope {
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+private:
+    using _Node = SharedPtr<_RopeNode>;
+
+    static constexpr std::size_t _S_chunk_size = 2048; // 从长字符串构造时每块的大小
+    static constexpr std::size_t _S_merge_size = 512;  // 相邻两个叶子都小于此值时合并为一块，避免碎片
+
+    _Node _M_root; // 空 Rope 的根为 nullptr
+
+    explicit Rope(_Node __root) noexcept : _M_root(std::move(__root)) {}
+
+    static std::size_t _S_size(_Node const &__n) noexcept {
+        return __n ? __n->_M_size : 0;
+    }
+
+    static unsigned _S_height(_Node const &__n) noexcept {
+        return __n ? __n->_M_height : 0;
+    }
+
+    static _Node _S_leaf(std::string_view __sv) {
+        return makeShared<_RopeNode>(_RopeNode{__sv.size(), 0, nullptr, nullptr, String(__sv)});
+    }
+
+    static _Node _S_make_node(_Node __left, _Node __right) {
+        if (__left->_M_is_leaf() && __right->_M_is_leaf() &&
+            __left->_M_size + __right->_M_size <= _S_merge_size) {
+            return _S_leaf(__left->_M_chunk + __right->_M_chunk);
+        }
+        std::size_t __size = __left->_M_size + __right->_M_size;
+        unsigned __height = std::max(__left->_M_height, __right->_M_height) + 1;
+        return makeShared<_RopeNode>(_RopeNode{__size, __height, std::move(__left), std::move(__right), String()});
+    }
+
+    // 把长字符串按 _S_chunk_size 切块，直接建成一棵完全平衡的树
+    static _Node _S_build(char const *__s, std::size_t __n) {
+        if (__n == 0)
+            return nullptr;
+        if (__n <= _S_chunk_size)
+            return _S_leaf(std::string_view(__s, __n));
+        std::size_t __chunks = (__n + _S_chunk_size - 1) / _S_chunk_size;
+        std::size_t __mid = __chunks / 2 * _S_chunk_size;
+        return _S_make_node(_S_build(__s, __mid), _S_build(__s + __mid, __n - __mid));
+    }
+
+    // 连接两棵平衡树：高度相近时直接新建一个父节点，O(1)
+    // 否则沿较高那棵的边缘往下走到高度相近处再挂上去，回溯时旋转恢复平衡，O(高度差)
+    static _Node _S_join(_Node const &__left, _Node const &__right) {
+        if (!__left)
+            return __right;
+        if (!__right)
+            return __left;
+        unsigned __hl = __left->_M_height, __hr = __right->_M_height;
+        if (__hl > __hr + 1) {
+            _Node __t = _S_join(__left->_M_right, __right);
+            _Node const &__ll = __left->_M_left;
+            if (__t->_M_height <= __ll->_M_height + 1)
+                return _S_make_node(__ll, std::move(__t));
+            // __t 比 __ll 高 2，需要旋转
+            if (__t->_M_left->_M_height <= __t->_M_right->_M_height)
+                return _S_make_node(_S_make_node(__ll, __t->_M_left), __t->_M_right); // 左旋
+            _Node const &__tl = __t->_M_left;
+            return _S_make_node(_S_make_node(__ll, __tl->_M_left), // 先右旋再左旋
+                                _S_make_node(__tl->_M_right, __t->_M_right));
+        }
+        if (__hr > __hl + 1) {
+            _Node __t = _S_join(__left, __right->_M_left);
+            _Node const &__rr = __right->_M_right;
+            if (__t->_M_height <= __rr->_M_height + 1)
+                return _S_make_node(std::move(__t), __rr);
+            if (__t->_M_right->_M_height <= __t->_M_left->_M_height)
+                return _S_make_node(__t->_M_left, _S_make_node(__t->_M_right, __rr)); // 右旋
+            _Node const &__tr = __t->_M_right;
+            return _S_make_node(_S_make_node(__t->_M_left, __tr->_M_left), // 先左旋再右旋
+                                _S_make_node(__tr->_M_right, __rr));
+        }
+        return _S_make_node(__left, __right);
+    }
+
+    // 在第 __pos 个字符处把树切成两棵，沿途的子树用 _S_join 重新拼起来，总复杂度 O(log n)
+    static std::pair<_Node, _Node> _S_split(_Node const &__node, std::size_t __pos) {
+        if (!__node)
+            return {nullptr, nullptr};
+        if (__pos == 0)
+            return {nullptr, __node};
+        if (__pos >= __node->_M_size)
+            return {__node, nullptr};
+        if (__node->_M_is_leaf()) {
+            std::string_view __sv = __node->_M_chunk;
+            return {_S_leaf(__sv.substr(0, __pos)), _S_leaf(__sv.substr(__pos))};
+        }
+        std::size_t __lsize = __node->_M_left->_M_size;
+        if (__pos <= __lsize) {
+            auto [__a, __b] = _S_split(__node->_M_left, __pos);
+            return {std::move(__a), _S_join(__b, __node->_M_right)};
+        } else {
+            auto [__a, __b] = _S_split(__node->_M_right, __pos - __lsize);
+            return {_S_join(__node->_M_left, __a), std::move(__b)};
+        }
+    }
+
+    void _M_check_pos(std::size_t __pos) const {
+        if (__pos > size()) [[unlikely]]
+            _LIBPENGCXX_THROW_OUT_OF_RANGE(__pos, size());
+    }
+
+public:
+    Rope() noexcept = default;
+
+    explicit Rope(std::string_view __sv) : _M_root(_S_build(__sv.data(), __sv.size())) {}
+
+    std::size_t size() const noexcept {
+        return _S_size(_M_root);
+    }
+
+    bool empty() const noexcept {
+        return !_M_root;
+    }
+
+    unsigned height() const noexcept {
+        return _S_height(_M_root);
+    }
+
+    void clear() noexcept {
+        _M_root.reset();
+    }
+
+    char operator[](std::size_t __i) const noexcept {
+        _RopeNode const *__node = _M_root.get();
+        while (!__node->_M_is_leaf()) {
+            std::size_t __lsize = __node->_M_left->_M_size;
+            if (__i < __lsize) {
+                __node = __node->_M_left.get();
+            } else {
+                __i -= __lsize;
+                __node = __node->_M_right.get();
+            }
+        }
+        return __node->_M_chunk[__i];
+    }
+
+    char at(std::size_t __i) const {
+        if (__i >= size()) [[unlikely]]
+            throw std::out_of_range("rope::at");
+        return (*this)[__i];
+    }
+
+    Rope &append(Rope const &__that) {
+        _M_root = _S_join(_M_root, __that._M_root);
+        return *this;
+    }
+
+    Rope &append(std::string_view __sv) {
+        return append(Rope(__sv));
+    }
+
+    Rope &operator+=(Rope const &__that) {
+        return append(__that);
+    }
+
+    Rope &operator+=(std::string_view __sv) {
+        return append(__sv);
+    }
+
+    friend Rope operator+(Rope const &__lhs, Rope const &__rhs) {
+        return Rope(_S_join(__lhs._M_root, __rhs._M_root));
+    }
+
+    Rope &insert(std::size_t __pos, Rope const &__that) {
+        _M_check_pos(__pos);
+        auto [__a, __b] = _S_split(_M_root, __pos);
+        _M_root = _S_join(_S_join(__a, __that._M_root), __b);
+        return *this;
+    }
+
+    Rope &insert(std::size_t __pos, std::string_view __sv) {
+        return insert(__pos, Rope(__sv));
+    }
+
+    Rope &erase(std::size_t __pos = 0, std::size_t __n = npos) {
+        _M_check_pos(__pos);
+        __n = std::min(__n, size() - __pos);
+        auto [__a, __bc] = _S_split(_M_root, __pos);
+        auto [__b, __c] = _S_split(__bc, __n);
+        _M_root = _S_join(__a, __c);
+        return *this;
+    }
+
+    Rope &replace(std::size_t __pos, std::size_t __n, Rope const &__that) {
+        erase(__pos, __n);
+        return insert(__pos, __that);
+    }
+
+    Rope substr(std::size_t __pos = 0, std::size_t __n = npos) const {
+        _M_check_pos(__pos);
+        __n = std::min(__n, size() - __pos);
+        return Rope(_S_split(_S_split(_M_root, __pos).second, __n).first);
+    }
+
+    // 按从左到右的顺序逐块访问，每块是一个 std::string_view，适合流式输出
+    struct ChunkIterator {
+    private:
+        Vector<_RopeNode const *> _M_stack; // 尚未访问的右子树
+        _RopeNode const *_M_leaf;
+
+        void _M_descend(_RopeNode const *__node) {
+            while (!__node->_M_is_leaf()) {
+                _M_stack.push_back(__node->_M_right.get());
+                __node = __node->_M_left.get();
+            }
+            _M_leaf = __node;
+        }
+
+        friend struct Rope;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::string_view const *;
+        using reference = std::string_view;
+
+        ChunkIterator() noexcept : _M_leaf(nullptr) {}
+
+        std::string_view operator*() const noexcept {
+            return _M_leaf->_M_chunk;
+        }
+
+        ChunkIterator &operator++() {
+            if (_M_stack.empty()) {
+                _M_leaf = nullptr;
+            } else {
+                _RopeNode const *__next = _M_stack.back();
+                _M_stack.pop_back();
+                _M_descend(__next);
+            }
+            return *this;
+        }
+
+        ChunkIterator operator++(int) {
+            ChunkIterator __tmp = *this;
+            ++*this;
+            return __tmp;
+        }
+
+        bool operator==(ChunkIterator const &__that) const noexcept {
+            return _M_leaf == __that._M_leaf;
+        }
+
+        bool operator!=(ChunkIterator const &__that) const noexcept {
+            return _M_leaf != __that._M_leaf;
+        }
+    };
+
+    struct ChunkRange {
+        ChunkIterator _M_begin;
+
+        ChunkIterator begin() const {
+            return _M_begin;
+        }
+
+        ChunkIterator end() const noexcept {
+            return ChunkIterator();
+        }
+    };
+
+    ChunkRange chunks() const {
+        ChunkRange __range;
+        if (_M_root)
+            __range._M_begin._M_descend(_M_root.get());
+        return __range;
+    }
+
+    String str() const {
+        String __res;
+        __res.reserve(size());
+        for (std::string_view __chunk : chunks())
+            __res.append(__chunk);
+        return __res;
+    }
+
+    friend bool operator==(Rope const &__lhs, std::string_view __rhs) {
+        if (__lhs.size() != __rhs.size())
+            return false;
+        for (std::string_view __chunk : __lhs.chunks()) {
+            if (__rhs.substr(0, __chunk.size()) != __chunk)
+                return false;
+            __rhs.remove_prefix(__chunk.size());
+        }
+        return true;
+    }
+
+    friend std::ostream &operator<<(std::ostream &__os, Rope const &__r) {
+        for (std::string_view __chunk : __r.chunks())
+            __os << __chunk;
+        return __os;
+    }
+};
@@ -3,37 +3,251 @@
 #include "UniquePtr.hpp"
 #include <algorithm>
 #include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <new>
 #include <type_traits>
 #include <utility>
 
+// 引用计数策略：_SpAtomicPolicy 使用原子操作，SharedPtr 可以跨线程共享
+// _SpLocalPolicy 使用普通的 long，只能在一个线程内使用，拷贝与析构不再需要带 lock 前缀的读-改-写指令
+// _Count 是单个计数（IntrusiveRefCounted 使用），_Counts 是控制块的强、弱引用计数对
+struct _SpAtomicPolicy {
+    using _Count = std::atomic<long>;
+
+    static void _S_inc(_Count &__cnt) noexcept {
+        __cnt.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 减少计数用 release：本线程此前对对象的访问，都要发生在最后一个引用析构对象之前
+    static long _S_dec(_Count &__cnt) noexcept { // 返回减少前的值
+        return __cnt.fetch_sub(1, std::memory_order_release);
+    }
+
+    // 计数归零、即将析构对象时调用，与此前所有 release 减少配对
+    // 用 acquire 读取而不是 acquire 栅栏，效果相同，ThreadSanitizer 也能理解
+    static void _S_acquire(_Count const &__cnt) noexcept {
+        (void)__cnt.load(std::memory_order_acquire);
+    }
+
+    static long _S_load(_Count const &__cnt) noexcept {
+        return __cnt.load(std::memory_order_relaxed);
+    }
+
+    // 强、弱引用计数放在同一个 64 位原子变量中：低 32 位是强引用，高 32 位是弱引用
+    // 这样一次读取就能得到两者的快照，才能安全地判断“自己是唯一的拥有者”
+    // 代价是同一对象的强引用最多 2^32 - 1 个（而不是 long 的上限），超出时会进位到弱引用中；调试构建下由 assert 检查
+    struct _Counts {
+    private:
+        static constexpr std::uint64_t _S_weak_one = std::uint64_t(1) << 32;
+        static constexpr std::uint64_t _S_max_strong = _S_weak_one - 1;
+
+        std::atomic<std::uint64_t> _M_word{1 | _S_weak_one};
+
+        static long _S_strong(std::uint64_t __w) noexcept {
+            return static_cast<long>(__w & (_S_weak_one - 1));
+        }
+
+        static long _S_weak(std::uint64_t __w) noexcept {
+            return static_cast<long>(__w >> 32);
+        }
+
+    public:
+        void _M_inc() noexcept {
+            [[maybe_unused]] std::uint64_t __old = _M_word.fetch_add(1, std::memory_order_relaxed);
+            assert((__old & _S_max_strong) != _S_max_strong && "强引用计数超过 2^32 - 1");
+        }
+
+        long _M_dec() noexcept { // 返回减少前的强引用数
+            return _S_strong(_M_word.fetch_sub(1, std::memory_order_release));
+        }
+
+        // 一次加减 __n，供 share_n 与批量释放使用
+        void _M_add(long __n) noexcept {
+            assert(__n >= 0 && static_cast<std::uint64_t>(__n) <= _S_max_strong);
+            [[maybe_unused]] std::uint64_t __old = _M_word.fetch_add(static_cast<std::uint64_t>(__n), std::memory_order_relaxed);
+            assert((__old & _S_max_strong) + static_cast<std::uint64_t>(__n) <= _S_max_strong && "强引用计数超过 2^32 - 1");
+        }
+
+        long _M_sub(long __n) noexcept {
+            return _S_strong(_M_word.fetch_sub(static_cast<std::uint64_t>(__n), std::memory_order_release));
+        }
+
+        // 强引用不为 0 时加一并返回 true，用于 WeakPtr::lock：不能把已经归零的计数再加回来
+        bool _M_inc_if_nonzero() noexcept {
+            std::uint64_t __w = _M_word.load(std::memory_order_relaxed);
+            while (_S_strong(__w) != 0) {
+                if (_M_word.compare_exchange_weak(__w, __w + 1, std::memory_order_relaxed, std::memory_order_relaxed))
+                    return true;
+            }
+            return false;
+        }
+
+        void _M_weak_inc() noexcept {
+            _M_word.fetch_add(_S_weak_one, std::memory_order_relaxed);
+        }
+
+        long _M_weak_dec() noexcept { // 返回减少前的弱引用数
+            return _S_weak(_M_word.fetch_sub(_S_weak_one, std::memory_order_release));
+        }
+
+        long _M_load() const noexcept {
+            return _S_strong(_M_word.load(std::memory_order_relaxed));
+        }
+
+        // 只有一个强引用、没有 WeakPtr：除了调用者，没有任何人能再取得引用
+        // acquire 读取与其他引用此前的 release 减少配对，之后可以不经读-改-写直接析构
+        bool _M_sole_owner() const noexcept {
+            return _M_word.load(std::memory_order_acquire) == (1 | _S_weak_one);
+        }
+
+        void _M_acquire() const noexcept {
+            (void)_M_word.load(std::memory_order_acquire);
+        }
+    };
+};
+
+struct _SpLocalPolicy {
+    using _Count = long;
+
+    static void _S_inc(_Count &__cnt) noexcept {
+        ++__cnt;
+    }
+
+    static long _S_dec(_Count &__cnt) noexcept {
+        return __cnt--;
+    }
+
+    static void _S_acquire(_Count const &) noexcept {}
+
+    static long _S_load(_Count const &__cnt) noexcept {
+        return __cnt;
+    }
+
+    struct _Counts {
+    private:
+        long _M_refcnt = 1;
+        long _M_weakcnt = 1;
+
+    public:
+        void _M_inc() noexcept {
+            ++_M_refcnt;
+        }
+
+        long _M_dec() noexcept {
+            return _M_refcnt--;
+        }
+
+        void _M_add(long __n) noexcept {
+            _M_refcnt += __n;
+        }
+
+        long _M_sub(long __n) noexcept {
+            long __old = _M_refcnt;
+            _M_refcnt -= __n;
+            return __old;
+        }
+
+        bool _M_inc_if_nonzero() noexcept {
+            if (_M_refcnt == 0)
+                return false;
+            ++_M_refcnt;
+            return true;
+        }
+
+        void _M_weak_inc() noexcept {
+            ++_M_weakcnt;
+        }
+
+        long _M_weak_dec() noexcept {
+            return _M_weakcnt--;
+        }
+
+        long _M_load() const noexcept {
+            return _M_refcnt;
+        }
+
+        bool _M_sole_owner() const noexcept {
+            return _M_refcnt == 1 && _M_weakcnt == 1;
+        }
+
+        void _M_acquire() const noexcept {}
+    };
+};
+
+// 控制块：强引用归零时析构对象（_M_dispose），弱引用也归零时才释放控制块本身（_M_destroy）
+// 所有强引用合起来算作一个弱引用，这样强引用归零的那一刻，控制块不会被并发的 WeakPtr 析构提前释放
+template <class _Policy>
 struct _SpCounter {
-    std::atomic<long> _M_refcnt;
+    typename _Policy::_Counts _M_counts;
 
-    _SpCounter() noexcept : _M_refcnt(1) {}
+    _SpCounter() noexcept = default;
 
     _SpCounter(_SpCounter &&) = delete;
 
     void _M_incref() noexcept {
-        _M_refcnt.fetch_add(1, std::memory_order_relaxed);
+        _M_counts._M_inc();
     }
 
     void _M_decref() noexcept {
-        if (_M_refcnt.fetch_sub(1, std::memory_order_relaxed) == 1) {
-            delete this;
+        // 大量 SharedPtr 从头到尾只有一个拥有者：这时不需要原子减法，直接析构对象并释放控制块
+        if (_M_counts._M_sole_owner()) {
+            _M_dispose();
+            _M_destroy();
+            return;
+        }
+        if (_M_counts._M_dec() == 1) {
+            _M_counts._M_acquire();
+            _M_dispose();
+            _M_weak_decref();
+        }
+    }
+
+    void _M_incref_n(long __n) noexcept {
+        _M_counts._M_add(__n);
+    }
+
+    void _M_decref_n(long __n) noexcept {
+        if (_M_counts._M_sub(__n) == __n) {
+            _M_counts._M_acquire();
+            _M_dispose();
+            _M_weak_decref();
+        }
+    }
+
+    bool _M_incref_if_nonzero() noexcept {
+        return _M_counts._M_inc_if_nonzero();
+    }
+
+    void _M_weak_incref() noexcept {
+        _M_counts._M_weak_inc();
+    }
+
+    void _M_weak_decref() noexcept {
+        if (_M_counts._M_weak_dec() == 1) {
+            _M_counts._M_acquire();
+            _M_destroy();
         }
     }
 
     long _M_cntref() const noexcept {
-        return _M_refcnt.load(std::memory_order_relaxed);
+        return _M_counts._M_load();
+    }
+
+    virtual void _M_dispose() noexcept = 0; // 析构所管理的对象
+
+    virtual void _M_destroy() noexcept { // 释放控制块
+        delete this;
     }
 
     virtual ~_SpCounter() = default;
 };
 
-template <class _Tp, class _Deleter>
-struct _SpCounterImpl final : _SpCounter {
+template <class _Tp, class _Deleter, class _Policy>
+struct _SpCounterImpl final : _SpCounter<_Policy> {
     _Tp *_M_ptr;
     [[no_unique_address]] _Deleter _M_deleter;
 
@@ -43,48 +257,137 @@ struct _SpCounterImpl final : _SpCounter {
         : _M_ptr(__ptr),
           _M_deleter(std::move(__deleter)) {}
 
-    ~_SpCounterImpl() noexcept override {
+    void _M_dispose() noexcept override {
         _M_deleter(_M_ptr);
     }
 };
 
-template <class _Tp, class _Deleter>
-struct _SpCounterImplFused final : _SpCounter {
+// 控制块本身由用户的分配器分配（rebind 到自身类型），释放时也还给它
+template <class _Tp, class _Deleter, class _Alloc, class _Policy>
+struct _SpCounterImplAlloc final : _SpCounter<_Policy> {
+    using _AllocTraits = typename std::allocator_traits<_Alloc>::template rebind_traits<_SpCounterImplAlloc>;
+    using _SelfAlloc = typename _AllocTraits::allocator_type;
+
     _Tp *_M_ptr;
-    void *_M_mem;
     [[no_unique_address]] _Deleter _M_deleter;
+    [[no_unique_address]] _SelfAlloc _M_alloc;
 
-    explicit _SpCounterImplFused(_Tp *__ptr, void *__mem,
-                                 _Deleter __deleter) noexcept
+    explicit _SpCounterImplAlloc(_Tp *__ptr, _Deleter __deleter, _SelfAlloc const &__alloc) noexcept
         : _M_ptr(__ptr),
-          _M_mem(__mem),
-          _M_deleter(std::move(__deleter)) {}
+          _M_deleter(std::move(__deleter)),
+          _M_alloc(__alloc) {}
+
+    void _M_dispose() noexcept override {
+        _M_deleter(_M_ptr);
+    }
+
+    void _M_destroy() noexcept override {
+        _SelfAlloc __alloc(std::move(_M_alloc));
+        auto __mem = std::pointer_traits<typename _AllocTraits::pointer>::pointer_to(*this);
+        this->~_SpCounterImplAlloc();
+        _AllocTraits::deallocate(__alloc, __mem, 1);
+    }
+
+    // 分配失败时按约定用 __deleter 释放 __ptr，再把异常抛出
+    static _SpCounter<_Policy> *_S_create(_Tp *__ptr, _Deleter __deleter, _Alloc const &__alloc) {
+        _SelfAlloc __self_alloc(__alloc);
+        _SpCounterImplAlloc *__counter;
+        try {
+            __counter = std::to_address(_AllocTraits::allocate(__self_alloc, 1));
+        } catch (...) {
+            __deleter(__ptr);
+            throw;
+        }
+        return ::new (static_cast<void *>(__counter))
+            _SpCounterImplAlloc(__ptr, std::move(__deleter), __self_alloc);
+    }
+};
 
-    ~_SpCounterImplFused() noexcept {
+// 一次分配的内存以 _SpFusedBlock 为单位向分配器申请，这样分配器只需 rebind 到这一个类型
+template <std::size_t _Align>
+struct _SpFusedBlock {
+    alignas(_Align) unsigned char _M_data[_Align];
+};
+
+template <class _Tp, class _Deleter, class _Alloc, class _Policy>
+struct _SpCounterImplFused final : _SpCounter<_Policy> {
+    using _AllocTraits = std::allocator_traits<_Alloc>;
+
+    _Tp *_M_ptr;
+    std::size_t _M_blocks; // 整块内存（控制块 + 对象）占多少个 _SpFusedBlock
+    [[no_unique_address]] _Deleter _M_deleter;
+    [[no_unique_address]] _Alloc _M_alloc;
+
+    explicit _SpCounterImplFused(_Tp *__ptr, std::size_t __blocks,
+                                 _Deleter __deleter, _Alloc const &__alloc) noexcept
+        : _M_ptr(__ptr),
+          _M_blocks(__blocks),
+          _M_deleter(std::move(__deleter)),
+          _M_alloc(__alloc) {}
+
+    // 对象先于控制块析构，但它所在的内存与控制块一起，直到弱引用也归零时才释放
+    void _M_dispose() noexcept override {
         _M_deleter(_M_ptr);
     }
 
-    void operator delete(void *__mem) noexcept {
-#if __cpp_aligned_new
-        ::operator delete(
-            __mem, std::align_val_t(
-                        std::max(alignof(_Tp), alignof(_SpCounterImplFused))));
-#else
-        ::operator delete(__mem);
-#endif
+    // 控制块位于整块内存的开头，先析构自身，再用取出的分配器归还整块内存
+    void _M_destroy() noexcept override {
+        _Alloc __alloc(std::move(_M_alloc));
+        std::size_t __blocks = _M_blocks;
+        auto __mem = std::pointer_traits<typename _AllocTraits::pointer>::pointer_to(
+            *reinterpret_cast<typename _AllocTraits::value_type *>(this));
+        this->~_SpCounterImplFused();
+        _AllocTraits::deallocate(__alloc, __mem, __blocks);
+    }
+};
+
+// 一次分配的数组由控制块记住长度，按构造的逆序析构元素；平凡析构的元素什么也不用做
+template <class _Tp>
+struct _SpArrayDestroyer {
+    std::size_t _M_len;
+
+    void operator()(_Tp *__ptr) const noexcept {
+        if constexpr (!std::is_trivially_destructible_v<_Tp>) {
+            for (std::size_t __i = _M_len; __i != 0; --__i) {
+                __ptr[__i - 1].~_Tp();
+            }
+        }
     }
 };
 
+template <class _Tp, class _Policy = _SpAtomicPolicy>
+struct WeakPtr;
+
 template <class _Tp>
+struct AtomicSharedPtr;
+
+template <class _Tp, class _Policy>
+struct SharedPtrBatch;
+
+struct SharedPtrReleaseBuffer;
+
+// _Policy 决定引用计数是否为原子的，见 LocalSharedPtr
+template <class _Tp, class _Policy = _SpAtomicPolicy>
 struct SharedPtr {
 private:
     _Tp *_M_ptr;
-    _SpCounter *_M_owner;
+    _SpCounter<_Policy> *_M_owner;
 
-    template <class>
+    template <class, class>
     friend struct SharedPtr;
 
-    explicit SharedPtr(_Tp *__ptr, _SpCounter *__owner) noexcept
+    template <class, class>
+    friend struct WeakPtr;
+
+    template <class>
+    friend struct AtomicSharedPtr;
+
+    template <class, class>
+    friend struct SharedPtrBatch;
+
+    friend struct SharedPtrReleaseBuffer;
+
+    explicit SharedPtr(_Tp *__ptr, _SpCounter<_Policy> *__owner) noexcept
         : _M_ptr(__ptr),
           _M_owner(__owner) {}
 
@@ -92,13 +395,13 @@ public:
     using element_type = _Tp;
     using pointer = _Tp *;
 
-    SharedPtr(std::nullptr_t = nullptr) noexcept : _M_owner(nullptr) {}
+    SharedPtr(std::nullptr_t = nullptr) noexcept : _M_ptr(nullptr), _M_owner(nullptr) {}
 
     template <class _Yp,
               std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
     explicit SharedPtr(_Yp *__ptr)
         : _M_ptr(__ptr),
-          _M_owner(new _SpCounterImpl<_Yp, DefaultDeleter<_Yp>>(__ptr)) {
+          _M_owner(new _SpCounterImpl<_Yp, DefaultDeleter<_Yp>, _Policy>(__ptr)) {
         _S_setupEnableSharedFromThis(_M_ptr, _M_owner);
     }
 
@@ -106,18 +409,41 @@ public:
               std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
     explicit SharedPtr(_Yp *__ptr, _Deleter __deleter)
         : _M_ptr(__ptr),
-          _M_owner(new _SpCounterImpl<_Yp, _Deleter>(__ptr, std::move(__deleter))) {
+          _M_owner(new _SpCounterImpl<_Yp, _Deleter, _Policy>(__ptr, std::move(__deleter))) {
         _S_setupEnableSharedFromThis(_M_ptr, _M_owner);
     }
 
-    template <class _Yp, class _Deleter,
+    // 控制块从 __alloc 分配，而不是全局的 new
+    template <class _Yp, class _Deleter, class _Alloc,
               std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    explicit SharedPtr(_Yp *__ptr, _Deleter __deleter, _Alloc const &__alloc)
+        : _M_ptr(__ptr),
+          _M_owner(_SpCounterImplAlloc<_Yp, _Deleter, _Alloc, _Policy>::_S_create(
+              __ptr, std::move(__deleter), __alloc)) {
+        _S_setupEnableSharedFromThis(_M_ptr, _M_owner);
+    }
+
+    // 只接受保存裸指针的 UniquePtr，删除器随所有权一起转移
+    template <class _Yp, class _Deleter,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *> &&
+                               std::is_same_v<typename UniquePtr<_Yp, _Deleter>::pointer, _Yp *>, int> = 0>
     explicit SharedPtr(UniquePtr<_Yp, _Deleter> &&__ptr)
-        : SharedPtr(__ptr.release(), __ptr.get_deleter()) {}
+        : SharedPtr(__ptr.release(), std::move(__ptr.get_deleter())) {}
 
-    template <class _Yp>
-    inline friend SharedPtr<_Yp>
-    _S_makeSharedFused(_Yp *__ptr, _SpCounter *__owner) noexcept;
+    // WeakPtr 已经失效时抛出 std::bad_weak_ptr
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    explicit SharedPtr(WeakPtr<_Yp, _Policy> const &__that)
+        : _M_ptr(__that._M_ptr),
+          _M_owner(__that._M_owner) {
+        if (!_M_owner || !_M_owner->_M_incref_if_nonzero()) {
+            throw std::bad_weak_ptr();
+        }
+    }
+
+    template <class _Yp, class _Pol>
+    inline friend SharedPtr<_Yp, _Pol>
+    _S_makeSharedFused(std::remove_extent_t<_Yp> *__ptr, _SpCounter<_Pol> *__owner) noexcept;
 
     SharedPtr(SharedPtr const &__that) noexcept
         : _M_ptr(__that._M_ptr),
@@ -129,7 +455,7 @@ public:
 
     template <class _Yp,
               std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
-    SharedPtr(SharedPtr<_Yp> const &__that) noexcept
+    SharedPtr(SharedPtr<_Yp, _Policy> const &__that) noexcept
         : _M_ptr(__that._M_ptr),
           _M_owner(__that._M_owner) {
         if (_M_owner) {
@@ -146,7 +472,7 @@ public:
 
     template <class _Yp,
               std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
-    SharedPtr(SharedPtr<_Yp> &&__that) noexcept
+    SharedPtr(SharedPtr<_Yp, _Policy> &&__that) noexcept
         : _M_ptr(__that._M_ptr),
           _M_owner(__that._M_owner) {
         __that._M_ptr = nullptr;
@@ -154,7 +480,7 @@ public:
     }
 
     template <class _Yp>
-    SharedPtr(SharedPtr<_Yp> const &__that, _Tp *__ptr) noexcept
+    SharedPtr(SharedPtr<_Yp, _Policy> const &__that, _Tp *__ptr) noexcept
         : _M_ptr(__ptr),
           _M_owner(__that._M_owner) {
         if (_M_owner) {
@@ -163,7 +489,7 @@ public:
     }
 
     template <class _Yp>
-    SharedPtr(SharedPtr<_Yp> &&__that, _Tp *__ptr) noexcept
+    SharedPtr(SharedPtr<_Yp, _Policy> &&__that, _Tp *__ptr) noexcept
         : _M_ptr(__ptr),
           _M_owner(__that._M_owner) {
         __that._M_ptr = nullptr;
@@ -201,7 +527,7 @@ public:
 
     template <class _Yp,
               std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
-    SharedPtr &operator=(SharedPtr<_Yp> const &__that) noexcept {
+    SharedPtr &operator=(SharedPtr<_Yp, _Policy> const &__that) noexcept {
         if (this == &__that) {
             return *this;
         }
@@ -218,7 +544,7 @@ public:
 
     template <class _Yp,
               std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
-    SharedPtr &operator=(SharedPtr<_Yp> &&__that) noexcept {
+    SharedPtr &operator=(SharedPtr<_Yp, _Policy> &&__that) noexcept {
         if (this == &__that) {
             return *this;
         }
@@ -248,7 +574,7 @@ public:
         _M_ptr = nullptr;
         _M_owner = nullptr;
         _M_ptr = __ptr;
-        _M_owner = new _SpCounterImpl<_Yp, DefaultDeleter<_Yp>>(__ptr);
+        _M_owner = new _SpCounterImpl<_Yp, DefaultDeleter<_Yp>, _Policy>(__ptr);
         _S_setupEnableSharedFromThis(_M_ptr, _M_owner);
     }
 
@@ -260,10 +586,15 @@ public:
         _M_ptr = nullptr;
         _M_owner = nullptr;
         _M_ptr = __ptr;
-        _M_owner = new _SpCounterImpl<_Yp, _Deleter>(__ptr, std::move(__deleter));
+        _M_owner = new _SpCounterImpl<_Yp, _Deleter, _Policy>(__ptr, std::move(__deleter));
         _S_setupEnableSharedFromThis(_M_ptr, _M_owner);
     }
 
+    template <class _Yp, class _Deleter, class _Alloc>
+    void reset(_Yp *__ptr, _Deleter __deleter, _Alloc const &__alloc) {
+        SharedPtr(__ptr, std::move(__deleter), __alloc).swap(*this);
+    }
+
     ~SharedPtr() noexcept {
         if (_M_owner) {
             _M_owner->_M_decref();
@@ -279,42 +610,42 @@ public:
     }
 
     template <class _Yp>
-    bool operator==(SharedPtr<_Yp> const &__that) const noexcept {
+    bool operator==(SharedPtr<_Yp, _Policy> const &__that) const noexcept {
         return _M_ptr == __that._M_ptr;
     }
 
     template <class _Yp>
-    bool operator!=(SharedPtr<_Yp> const &__that) const noexcept {
+    bool operator!=(SharedPtr<_Yp, _Policy> const &__that) const noexcept {
         return _M_ptr != __that._M_ptr;
     }
 
     template <class _Yp>
-    bool operator<(SharedPtr<_Yp> const &__that) const noexcept {
+    bool operator<(SharedPtr<_Yp, _Policy> const &__that) const noexcept {
         return _M_ptr < __that._M_ptr;
     }
 
     template <class _Yp>
-    bool operator<=(SharedPtr<_Yp> const &__that) const noexcept {
+    bool operator<=(SharedPtr<_Yp, _Policy> const &__that) const noexcept {
         return _M_ptr <= __that._M_ptr;
     }
 
     template <class _Yp>
-    bool operator>(SharedPtr<_Yp> const &__that) const noexcept {
+    bool operator>(SharedPtr<_Yp, _Policy> const &__that) const noexcept {
         return _M_ptr > __that._M_ptr;
     }
 
     template <class _Yp>
-    bool operator>=(SharedPtr<_Yp> const &__that) const noexcept {
+    bool operator>=(SharedPtr<_Yp, _Policy> const &__that) const noexcept {
         return _M_ptr >= __that._M_ptr;
     }
 
     template <class _Yp>
-    bool owner_before(SharedPtr<_Yp> const &__that) const noexcept {
+    bool owner_before(SharedPtr<_Yp, _Policy> const &__that) const noexcept {
         return _M_owner < __that._M_owner;
     }
 
     template <class _Yp>
-    bool owner_equal(SharedPtr<_Yp> const &__that) const noexcept {
+    bool owner_equal(SharedPtr<_Yp, _Policy> const &__that) const noexcept {
         return _M_owner == __that._M_owner;
     }
 
@@ -323,6 +654,16 @@ public:
         std::swap(_M_owner, __that._M_owner);
     }
 
+    // 一次性预先取得 __n 个引用，只做一次原子加法，之后从批次中逐个 take() 不再碰引用计数
+    // __n 连同已有的强引用不能超过策略的上限（_SpAtomicPolicy 为 2^32 - 1）
+    SharedPtrBatch<_Tp, _Policy> share_n(std::size_t __n) const noexcept {
+        assert(__n <= static_cast<std::size_t>(std::numeric_limits<long>::max()));
+        if (_M_owner && __n != 0) {
+            _M_owner->_M_incref_n(static_cast<long>(__n));
+        }
+        return SharedPtrBatch<_Tp, _Policy>(_M_ptr, _M_owner, _M_owner ? __n : 0);
+    }
+
     _Tp *get() const noexcept {
         return _M_ptr;
     }
@@ -340,186 +681,715 @@ public:
     }
 };
 
-template <class _Tp>
-inline SharedPtr<_Tp> _S_makeSharedFused(_Tp *__ptr,
-                                         _SpCounter *__owner) noexcept {
-    return SharedPtr<_Tp>(__ptr, __owner);
+template <class _Tp, class _Policy>
+inline SharedPtr<_Tp, _Policy> _S_makeSharedFused(std::remove_extent_t<_Tp> *__ptr,
+                                                  _SpCounter<_Policy> *__owner) noexcept {
+    return SharedPtr<_Tp, _Policy>(__ptr, __owner);
 }
 
-template <class _Tp>
-struct SharedPtr<_Tp[]> : SharedPtr<_Tp> {
-    using SharedPtr<_Tp>::SharedPtr;
+template <class _Tp, class _Policy>
+struct SharedPtr<_Tp[], _Policy> : SharedPtr<_Tp, _Policy> {
+private:
+    template <class, class>
+    friend struct SharedPtr;
+
+    template <class _Yp, class _Pol>
+    inline friend SharedPtr<_Yp, _Pol>
+    _S_makeSharedFused(std::remove_extent_t<_Yp> *__ptr, _SpCounter<_Pol> *__owner) noexcept;
+
+    explicit SharedPtr(_Tp *__ptr, _SpCounter<_Policy> *__owner) noexcept
+        : SharedPtr<_Tp, _Policy>(__ptr, __owner) {}
+
+public:
+    using SharedPtr<_Tp, _Policy>::SharedPtr;
+    using SharedPtr<_Tp, _Policy>::reset;
+
+    // 隐藏基类中只带裸指针的版本：数组必须用 delete[] 释放；同 DefaultDeleter<T[]>，只允许添加 const/volatile 的转换
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp (*)[], _Tp (*)[]>, int> = 0>
+    explicit SharedPtr(_Yp *__ptr)
+        : SharedPtr<_Tp, _Policy>(__ptr, DefaultDeleter<_Tp[]>()) {}
+
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp (*)[], _Tp (*)[]>, int> = 0>
+    void reset(_Yp *__ptr) {
+        this->reset(__ptr, DefaultDeleter<_Tp[]>());
+    }
 
     std::add_lvalue_reference_t<_Tp> operator[](std::size_t __i) {
         return this->get()[__i];
     }
 };
 
+// 定长数组，由 makeShared<T[N]>() 创建；可以当作 SharedPtr<T[]> 使用
+template <class _Tp, std::size_t _Nm, class _Policy>
+struct SharedPtr<_Tp[_Nm], _Policy> : SharedPtr<_Tp[], _Policy> {
+private:
+    template <class _Yp, class _Pol>
+    inline friend SharedPtr<_Yp, _Pol>
+    _S_makeSharedFused(std::remove_extent_t<_Yp> *__ptr, _SpCounter<_Pol> *__owner) noexcept;
+
+    explicit SharedPtr(_Tp *__ptr, _SpCounter<_Policy> *__owner) noexcept
+        : SharedPtr<_Tp[], _Policy>(__ptr, __owner) {}
+
+public:
+    using SharedPtr<_Tp[], _Policy>::SharedPtr;
+};
+
+template <class _Tp, class _Policy>
+struct EnableSharedFromThis;
+
+// 不持有对象的引用，只持有控制块的弱引用：对象可能已经析构，需要先 lock() 得到 SharedPtr 再访问
+template <class _Tp, class _Policy>
+struct WeakPtr {
+private:
+    _Tp *_M_ptr;
+    _SpCounter<_Policy> *_M_owner;
+
+    template <class, class>
+    friend struct WeakPtr;
+
+    template <class, class>
+    friend struct SharedPtr;
+
+    template <class _Up, class _Pol>
+    inline friend void
+    _S_setEnableSharedFromThisOwner(EnableSharedFromThis<_Up, _Pol> *, _SpCounter<_Pol> *);
+
+public:
+    using element_type = _Tp;
+
+    WeakPtr() noexcept : _M_ptr(nullptr), _M_owner(nullptr) {}
+
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    WeakPtr(SharedPtr<_Yp, _Policy> const &__that) noexcept
+        : _M_ptr(__that._M_ptr),
+          _M_owner(__that._M_owner) {
+        if (_M_owner) {
+            _M_owner->_M_weak_incref();
+        }
+    }
+
+    WeakPtr(WeakPtr const &__that) noexcept
+        : _M_ptr(__that._M_ptr),
+          _M_owner(__that._M_owner) {
+        if (_M_owner) {
+            _M_owner->_M_weak_incref();
+        }
+    }
+
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    WeakPtr(WeakPtr<_Yp, _Policy> const &__that) noexcept
+        : _M_ptr(__that._M_ptr),
+          _M_owner(__that._M_owner) {
+        if (_M_owner) {
+            _M_owner->_M_weak_incref();
+        }
+    }
+
+    WeakPtr(WeakPtr &&__that) noexcept
+        : _M_ptr(std::exchange(__that._M_ptr, nullptr)),
+          _M_owner(std::exchange(__that._M_owner, nullptr)) {}
+
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    WeakPtr(WeakPtr<_Yp, _Policy> &&__that) noexcept
+        : _M_ptr(std::exchange(__that._M_ptr, nullptr)),
+          _M_owner(std::exchange(__that._M_owner, nullptr)) {}
+
+    WeakPtr &operator=(WeakPtr const &__that) noexcept {
+        WeakPtr(__that).swap(*this);
+        return *this;
+    }
+
+    WeakPtr &operator=(WeakPtr &&__that) noexcept {
+        WeakPtr(std::move(__that)).swap(*this);
+        return *this;
+    }
+
+    template <class _Yp,
+              std::enable_if_t<std::is_convertible_v<_Yp *, _Tp *>, int> = 0>
+    WeakPtr &operator=(SharedPtr<_Yp, _Policy> const &__that) noexcept {
+        WeakPtr(__that).swap(*this);
+        return *this;
+    }
+
+    ~WeakPtr() noexcept {
+        if (_M_owner) {
+            _M_owner->_M_weak_decref();
+        }
+    }
+
+    void reset() noexcept {
+        WeakPtr().swap(*this);
+    }
+
+    void swap(WeakPtr &__that) noexcept {
+        std::swap(_M_ptr, __that._M_ptr);
+        std::swap(_M_owner, __that._M_owner);
+    }
+
+    long use_count() const noexcept {
+        return _M_owner ? _M_owner->_M_cntref() : 0;
+    }
+
+    bool expired() const noexcept {
+        return use_count() == 0;
+    }
+
+    // 强引用数不为 0 时才加一（CAS 循环），否则返回空的 SharedPtr
+    SharedPtr<_Tp, _Policy> lock() const noexcept {
+        if (_M_owner && _M_owner->_M_incref_if_nonzero()) {
+            return SharedPtr<_Tp, _Policy>(_M_ptr, _M_owner);
+        }
+        return nullptr;
+    }
+
+    template <class _Yp>
+    bool owner_before(WeakPtr<_Yp, _Policy> const &__that) const noexcept {
+        return _M_owner < __that._M_owner;
+    }
+
+    template <class _Yp>
+    bool owner_before(SharedPtr<_Yp, _Policy> const &__that) const noexcept {
+        return _M_owner < __that._M_owner;
+    }
+};
+
+// 单线程使用的 SharedPtr：引用计数不是原子的，不得跨线程拷贝或析构
+// 与 SharedPtr 一样可以由 makeLocalShared 一次分配出控制块与对象
 template <class _Tp>
+using LocalSharedPtr = SharedPtr<_Tp, _SpLocalPolicy>;
+
+template <class _Tp>
+using LocalWeakPtr = WeakPtr<_Tp, _SpLocalPolicy>;
+
+// 对象内保存自己控制块的弱引用，不会因此延长自己的生命周期
+template <class _Tp, class _Policy = _SpAtomicPolicy>
 struct EnableSharedFromThis {
 private:
-    _SpCounter *_M_owner;
+    WeakPtr<_Tp, _Policy> _M_weak;
 
 protected:
-    EnableSharedFromThis() noexcept : _M_owner(nullptr) {}
+    EnableSharedFromThis() noexcept = default;
+
+    // 拷贝出来的是一个新对象，不属于原来的控制块
+    EnableSharedFromThis(EnableSharedFromThis const &) noexcept {}
 
-    SharedPtr<_Tp> shared_from_this() {
+    EnableSharedFromThis &operator=(EnableSharedFromThis const &) noexcept {
+        return *this;
+    }
+
+    SharedPtr<_Tp, _Policy> shared_from_this() {
         static_assert(std::is_base_of_v<EnableSharedFromThis, _Tp>,
                       "must be derived class");
-        if (!_M_owner) {
-            throw std::bad_weak_ptr();
-        }
-        _M_owner->_M_incref();
-        return _S_makeSharedFused(static_cast<_Tp *>(this), _M_owner);
+        return SharedPtr<_Tp, _Policy>(_M_weak);
     }
 
-    SharedPtr<_Tp const> shared_from_this() const {
+    SharedPtr<_Tp const, _Policy> shared_from_this() const {
         static_assert(std::is_base_of_v<EnableSharedFromThis, _Tp>,
                       "must be derived class");
-        if (!_M_owner) {
-            throw std::bad_weak_ptr();
-        }
-        _M_owner->_M_incref();
-        return _S_makeSharedFused(static_cast<_Tp const *>(this), _M_owner);
+        return SharedPtr<_Tp const, _Policy>(_M_weak);
+    }
+
+    WeakPtr<_Tp, _Policy> weak_from_this() noexcept {
+        return _M_weak;
     }
 
-    template <class _Up>
+    WeakPtr<_Tp const, _Policy> weak_from_this() const noexcept {
+        return _M_weak;
+    }
+
+    template <class _Up, class _Pol>
     inline friend void
-    _S_setEnableSharedFromThisOwner(EnableSharedFromThis<_Up> *, _SpCounter *);
+    _S_setEnableSharedFromThisOwner(EnableSharedFromThis<_Up, _Pol> *, _SpCounter<_Pol> *);
 };
 
-template <class _Up>
-inline void _S_setEnableSharedFromThisOwner(EnableSharedFromThis<_Up> *__ptr,
-                                            _SpCounter *__owner) {
-    __ptr->_M_owner = __owner;
+// 对象已经被某个 SharedPtr 管理时保持原样
+template <class _Up, class _Policy>
+inline void _S_setEnableSharedFromThisOwner(EnableSharedFromThis<_Up, _Policy> *__ptr,
+                                            _SpCounter<_Policy> *__owner) {
+    if (__ptr->_M_weak.expired()) {
+        __owner->_M_weak_incref();
+        WeakPtr<_Up, _Policy> __weak;
+        __weak._M_ptr = static_cast<_Up *>(__ptr);
+        __weak._M_owner = __owner;
+        __ptr->_M_weak = std::move(__weak);
+    }
 }
 
-template <class _Tp,
-          std::enable_if_t<std::is_base_of_v<EnableSharedFromThis<_Tp>, _Tp>,
+template <class _Tp, class _Policy,
+          std::enable_if_t<std::is_base_of_v<EnableSharedFromThis<_Tp, _Policy>, _Tp>,
                            int> = 0>
-void _S_setupEnableSharedFromThis(_Tp *__ptr, _SpCounter *__owner) {
+void _S_setupEnableSharedFromThis(_Tp *__ptr, _SpCounter<_Policy> *__owner) {
     _S_setEnableSharedFromThisOwner(
-        static_cast<EnableSharedFromThis<_Tp> *>(__ptr), __owner);
+        static_cast<EnableSharedFromThis<_Tp, _Policy> *>(__ptr), __owner);
 }
 
-template <class _Tp,
-          std::enable_if_t<!std::is_base_of_v<EnableSharedFromThis<_Tp>, _Tp>,
+template <class _Tp, class _Policy,
+          std::enable_if_t<!std::is_base_of_v<EnableSharedFromThis<_Tp, _Policy>, _Tp>,
                            int> = 0>
-void _S_setupEnableSharedFromThis(_Tp *, _SpCounter *) {}
-
-template <class _Tp, class... _Args,
-          std::enable_if_t<!std::is_unbounded_array_v<_Tp>, int> = 0>
-SharedPtr<_Tp> makeShared(_Args &&...__args) {
-    auto const __deleter = [](_Tp *__ptr) noexcept {
-        __ptr->~_Tp();
-    };
-    using _Counter = _SpCounterImplFused<_Tp, decltype(__deleter)>;
-    constexpr std::size_t __offset = std::max(alignof(_Tp), sizeof(_Counter));
-    constexpr std::size_t __align = std::max(alignof(_Tp), alignof(_Counter));
-    constexpr std::size_t __size = __offset + sizeof(_Tp);
-#if __cpp_aligned_new
-    void *__mem = ::operator new(__size, std::align_val_t(__align));
-    _Counter *__counter = reinterpret_cast<_Counter *>(__mem);
-#else
-    void *__mem = ::operator new(__size + __align);
-    _Counter *__counter = reinterpret_cast<_SpC *>(
-        reinterpret_cast<std::size_t>(__mem) & __align);
-#endif
-    _Tp *__object =
-        reinterpret_cast<_Tp *>(reinterpret_cast<char *>(__counter) + __offset);
+void _S_setupEnableSharedFromThis(_Tp *, _SpCounter<_Policy> *) {}
+
+// 控制块与对象放在同一次分配中：控制块在前，对象（数组则是 __len 个元素）紧随其后
+// 内存来自 __alloc（rebind 到 _SpFusedBlock），__init(__object) 负责在 __object 处构造对象，__deleter 负责析构
+template <class _Tp, class _Policy, class _Alloc, class _Deleter, class _Init>
+SharedPtr<_Tp, _Policy> _S_allocateSharedFused(_Alloc const &__alloc, std::size_t __len,
+                                               _Deleter __deleter, _Init __init) {
+    using _Elem = std::remove_extent_t<_Tp>;
+    constexpr std::size_t __align = std::max(alignof(_Elem), alignof(std::max_align_t));
+    using _Block = _SpFusedBlock<__align>;
+    using _BlockAlloc = typename std::allocator_traits<_Alloc>::template rebind_alloc<_Block>;
+    using _BlockTraits = std::allocator_traits<_BlockAlloc>;
+    using _Counter = _SpCounterImplFused<_Elem, _Deleter, _BlockAlloc, _Policy>;
+    static_assert(alignof(_Counter) <= __align);
+    constexpr std::size_t __offset = (sizeof(_Counter) + alignof(_Elem) - 1) / alignof(_Elem) * alignof(_Elem);
+    if (__len > (std::size_t(-1) / 2 - __offset) / sizeof(_Elem)) {
+        throw std::bad_array_new_length();
+    }
+    std::size_t __blocks = (__offset + __len * sizeof(_Elem) + __align - 1) / __align;
+    _BlockAlloc __block_alloc(__alloc);
+    auto __mem = _BlockTraits::allocate(__block_alloc, __blocks);
+    void *__raw = std::to_address(__mem);
+    _Elem *__object = reinterpret_cast<_Elem *>(static_cast<char *>(__raw) + __offset);
     try {
-        new (__object) _Tp(std::forward<_Args>(__args)...);
+        __init(__object);
     } catch (...) {
-#if __cpp_aligned_new
-        ::operator delete(__mem, std::align_val_t(__align));
-#else
-        ::operator delete(__mem);
-#endif
+        _BlockTraits::deallocate(__block_alloc, __mem, __blocks);
         throw;
     }
-    new (__counter) _Counter(__object, __mem, __deleter);
-    _S_setupEnableSharedFromThis(__object, __counter);
-    return _S_makeSharedFused(__object, __counter);
+    _Counter *__counter = ::new (__raw) _Counter(__object, __blocks, std::move(__deleter), __block_alloc);
+    if constexpr (!std::is_array_v<_Tp>) {
+        _S_setupEnableSharedFromThis(__object, static_cast<_SpCounter<_Policy> *>(__counter));
+    }
+    return _S_makeSharedFused<_Tp, _Policy>(__object, static_cast<_SpCounter<_Policy> *>(__counter));
 }
 
-template <class _Tp, std::enable_if_t<!std::is_unbounded_array_v<_Tp>, int> = 0>
-SharedPtr<_Tp> makeSharedForOverwrite() {
-    auto const __deleter = [](_Tp *__ptr) noexcept {
+template <class _Tp>
+struct _SpObjectDestroyer {
+    void operator()(_Tp *__ptr) const noexcept {
         __ptr->~_Tp();
-    };
-    using _Counter = _SpCounterImplFused<_Tp, decltype(__deleter)>;
-    constexpr std::size_t __offset = std::max(alignof(_Tp), sizeof(_Counter));
-    constexpr std::size_t __align = std::max(alignof(_Tp), alignof(_Counter));
-    constexpr std::size_t __size = __offset + sizeof(_Tp);
-#if __cpp_aligned_new
-    void *__mem = ::operator new(__size, std::align_val_t(__align));
-    _Counter *__counter = reinterpret_cast<_Counter *>(__mem);
-#else
-    void *__mem = ::operator new(__size + __align);
-    _SpC *__counter = reinterpret_cast<_SpC *>(
-        reinterpret_cast<std::size_t>(__mem) & __align);
-#endif
-    _Tp *__object =
-        reinterpret_cast<_Tp *>(reinterpret_cast<char *>(__counter) + __offset);
-    try {
-        new (__object) _Tp;
-    } catch (...) {
-#if __cpp_aligned_new
-        ::operator delete(__mem, std::align_val_t(__align));
-#else
-        ::operator delete(__mem);
-#endif
-        throw;
     }
-    new (__counter) _Counter(__object, __mem, __deleter);
-    _S_setupEnableSharedFromThis(__object, __counter);
-    return _S_makeSharedFused(__object, __counter);
+};
+
+template <class _Tp, class _Policy, class _Alloc, class... _Args>
+SharedPtr<_Tp, _Policy> _S_allocateSharedObject(_Alloc const &__alloc, _Args &&...__args) {
+    return _S_allocateSharedFused<_Tp, _Policy>(__alloc, 1, _SpObjectDestroyer<_Tp>(), [&](_Tp *__object) {
+        ::new (static_cast<void *>(__object)) _Tp(std::forward<_Args>(__args)...);
+    });
+}
+
+template <class _Tp, class _Policy, class _Alloc>
+SharedPtr<_Tp, _Policy> _S_allocateSharedObjectForOverwrite(_Alloc const &__alloc) {
+    return _S_allocateSharedFused<_Tp, _Policy>(__alloc, 1, _SpObjectDestroyer<_Tp>(), [](_Tp *__object) {
+        ::new (static_cast<void *>(__object)) _Tp;
+    });
+}
+
+// 数组元素逐个值初始化（__overwrite 时默认初始化），构造中途抛出异常时已构造的元素会被析构
+template <class _Tp, class _Policy, class _Alloc>
+SharedPtr<_Tp, _Policy> _S_allocateSharedArray(_Alloc const &__alloc, std::size_t __len, bool __overwrite) {
+    using _Elem = std::remove_extent_t<_Tp>;
+    return _S_allocateSharedFused<_Tp, _Policy>(__alloc, __len, _SpArrayDestroyer<_Elem>{__len}, [&](_Elem *__object) {
+        if (__overwrite) {
+            std::uninitialized_default_construct_n(__object, __len);
+        } else {
+            std::uninitialized_value_construct_n(__object, __len);
+        }
+    });
 }
 
 template <class _Tp, class... _Args,
-          std::enable_if_t<std::is_unbounded_array_v<_Tp>, int> = 0>
+          std::enable_if_t<!std::is_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> makeShared(_Args &&...__args) {
+    return _S_allocateSharedObject<_Tp, _SpAtomicPolicy>(std::allocator<_Tp>(), std::forward<_Args>(__args)...);
+}
+
+template <class _Tp, std::enable_if_t<!std::is_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> makeSharedForOverwrite() {
+    return _S_allocateSharedObjectForOverwrite<_Tp, _SpAtomicPolicy>(std::allocator<_Tp>());
+}
+
+// 数组与控制块、长度也在同一次分配中，不再单独 new[]
+template <class _Tp, std::enable_if_t<std::is_unbounded_array_v<_Tp>, int> = 0>
 SharedPtr<_Tp> makeShared(std::size_t __len) {
-    std::remove_extent_t<_Tp> *__p = new std::remove_extent_t<_Tp>[__len];
-    try {
-        return SharedPtr<_Tp>(__p);
-    } catch (...) {
-        delete[] __p;
-        throw;
-    }
+    return _S_allocateSharedArray<_Tp, _SpAtomicPolicy>(std::allocator<_Tp>(), __len, false);
 }
 
 template <class _Tp, std::enable_if_t<std::is_unbounded_array_v<_Tp>, int> = 0>
 SharedPtr<_Tp> makeSharedForOverwrite(std::size_t __len) {
-    std::remove_extent_t<_Tp> *__p = new std::remove_extent_t<_Tp>[__len];
-    try {
-        return SharedPtr<_Tp>(__p);
-    } catch (...) {
-        delete[] __p;
-        throw;
-    }
+    return _S_allocateSharedArray<_Tp, _SpAtomicPolicy>(std::allocator<_Tp>(), __len, true);
+}
+
+template <class _Tp, std::enable_if_t<std::is_bounded_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> makeShared() {
+    return _S_allocateSharedArray<_Tp, _SpAtomicPolicy>(std::allocator<_Tp>(), std::extent_v<_Tp>, false);
+}
+
+template <class _Tp, std::enable_if_t<std::is_bounded_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> makeSharedForOverwrite() {
+    return _S_allocateSharedArray<_Tp, _SpAtomicPolicy>(std::allocator<_Tp>(), std::extent_v<_Tp>, true);
+}
+
+// 同 makeShared，但整块内存（控制块 + 对象）来自用户提供的分配器，例如每个线程自己的内存池
+template <class _Tp, class _Alloc, class... _Args,
+          std::enable_if_t<!std::is_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> allocateShared(_Alloc const &__alloc, _Args &&...__args) {
+    return _S_allocateSharedObject<_Tp, _SpAtomicPolicy>(__alloc, std::forward<_Args>(__args)...);
+}
+
+template <class _Tp, class _Alloc, std::enable_if_t<!std::is_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> allocateSharedForOverwrite(_Alloc const &__alloc) {
+    return _S_allocateSharedObjectForOverwrite<_Tp, _SpAtomicPolicy>(__alloc);
+}
+
+template <class _Tp, class _Alloc, std::enable_if_t<std::is_unbounded_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> allocateShared(_Alloc const &__alloc, std::size_t __len) {
+    return _S_allocateSharedArray<_Tp, _SpAtomicPolicy>(__alloc, __len, false);
 }
 
-template <class _Tp, class _Up>
-SharedPtr<_Tp> staticPointerCast(SharedPtr<_Up> const &__ptr) {
-    return SharedPtr<_Tp>(__ptr, static_cast<_Tp *>(__ptr.get()));
+template <class _Tp, class _Alloc, std::enable_if_t<std::is_unbounded_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> allocateSharedForOverwrite(_Alloc const &__alloc, std::size_t __len) {
+    return _S_allocateSharedArray<_Tp, _SpAtomicPolicy>(__alloc, __len, true);
 }
 
-template <class _Tp, class _Up>
-SharedPtr<_Tp> constPointerCast(SharedPtr<_Up> const &__ptr) {
-    return SharedPtr<_Tp>(__ptr, const_cast<_Tp *>(__ptr.get()));
+template <class _Tp, class _Alloc, std::enable_if_t<std::is_bounded_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> allocateShared(_Alloc const &__alloc) {
+    return _S_allocateSharedArray<_Tp, _SpAtomicPolicy>(__alloc, std::extent_v<_Tp>, false);
 }
 
-template <class _Tp, class _Up>
-SharedPtr<_Tp> reinterpretPointerCast(SharedPtr<_Up> const &__ptr) {
-    return SharedPtr<_Tp>(__ptr, reinterpret_cast<_Tp *>(__ptr.get()));
+template <class _Tp, class _Alloc, std::enable_if_t<std::is_bounded_array_v<_Tp>, int> = 0>
+SharedPtr<_Tp> allocateSharedForOverwrite(_Alloc const &__alloc) {
+    return _S_allocateSharedArray<_Tp, _SpAtomicPolicy>(__alloc, std::extent_v<_Tp>, true);
 }
 
-template <class _Tp, class _Up>
-SharedPtr<_Tp> dynamicPointerCast(SharedPtr<_Up> const &__ptr) {
+template <class _Tp, class... _Args,
+          std::enable_if_t<!std::is_array_v<_Tp>, int> = 0>
+LocalSharedPtr<_Tp> makeLocalShared(_Args &&...__args) {
+    return _S_allocateSharedObject<_Tp, _SpLocalPolicy>(std::allocator<_Tp>(), std::forward<_Args>(__args)...);
+}
+
+template <class _Tp, std::enable_if_t<!std::is_array_v<_Tp>, int> = 0>
+LocalSharedPtr<_Tp> makeLocalSharedForOverwrite() {
+    return _S_allocateSharedObjectForOverwrite<_Tp, _SpLocalPolicy>(std::allocator<_Tp>());
+}
+
+template <class _Tp, class _Up, class _Policy>
+SharedPtr<_Tp, _Policy> staticPointerCast(SharedPtr<_Up, _Policy> const &__ptr) {
+    return SharedPtr<_Tp, _Policy>(__ptr, static_cast<_Tp *>(__ptr.get()));
+}
+
+template <class _Tp, class _Up, class _Policy>
+SharedPtr<_Tp, _Policy> constPointerCast(SharedPtr<_Up, _Policy> const &__ptr) {
+    return SharedPtr<_Tp, _Policy>(__ptr, const_cast<_Tp *>(__ptr.get()));
+}
+
+template <class _Tp, class _Up, class _Policy>
+SharedPtr<_Tp, _Policy> reinterpretPointerCast(SharedPtr<_Up, _Policy> const &__ptr) {
+    return SharedPtr<_Tp, _Policy>(__ptr, reinterpret_cast<_Tp *>(__ptr.get()));
+}
+
+template <class _Tp, class _Up, class _Policy>
+SharedPtr<_Tp, _Policy> dynamicPointerCast(SharedPtr<_Up, _Policy> const &__ptr) {
     _Tp *__p = dynamic_cast<_Tp *>(__ptr.get());
     if (__p != nullptr) {
-        return SharedPtr<_Tp>(__ptr, __p);
+        return SharedPtr<_Tp, _Policy>(__ptr, __p);
     } else {
         return nullptr;
     }
 }
+
+// share_n 返回的一批引用：take() 取出一个 SharedPtr，析构时把没取走的引用一次性还回去
+template <class _Tp, class _Policy = _SpAtomicPolicy>
+struct SharedPtrBatch {
+private:
+    _Tp *_M_ptr;
+    _SpCounter<_Policy> *_M_owner;
+    std::size_t _M_left;
+
+    template <class, class>
+    friend struct SharedPtr;
+
+    explicit SharedPtrBatch(_Tp *__ptr, _SpCounter<_Policy> *__owner, std::size_t __n) noexcept
+        : _M_ptr(__ptr),
+          _M_owner(__owner),
+          _M_left(__n) {}
+
+public:
+    SharedPtrBatch(SharedPtrBatch &&__that) noexcept
+        : _M_ptr(__that._M_ptr),
+          _M_owner(std::exchange(__that._M_owner, nullptr)),
+          _M_left(std::exchange(__that._M_left, 0)) {}
+
+    SharedPtrBatch &operator=(SharedPtrBatch &&__that) noexcept {
+        if (this != &__that) [[likely]] {
+            _M_release();
+            _M_ptr = __that._M_ptr;
+            _M_owner = std::exchange(__that._M_owner, nullptr);
+            _M_left = std::exchange(__that._M_left, 0);
+        }
+        return *this;
+    }
+
+    ~SharedPtrBatch() noexcept {
+        _M_release();
+    }
+
+    std::size_t size() const noexcept {
+        return _M_left;
+    }
+
+    bool empty() const noexcept {
+        return _M_left == 0;
+    }
+
+    // 批次为空时返回空指针
+    SharedPtr<_Tp, _Policy> take() noexcept {
+        if (_M_left == 0) {
+            return nullptr;
+        }
+        --_M_left;
+        return SharedPtr<_Tp, _Policy>(_M_ptr, _M_owner);
+    }
+
+private:
+    void _M_release() noexcept {
+        if (_M_left != 0) {
+            _M_owner->_M_decref_n(static_cast<long>(_M_left));
+            _M_left = 0;
+        }
+    }
+};
+
+// 延迟释放缓冲区：把要丢弃的 SharedPtr 先记下来，同一个控制块的多次释放合并成一次原子减法
+// 适合一个线程短时间内丢弃大量指向同一对象的 SharedPtr 的场景（如发布订阅的扇出）
+// 对象的析构会推迟到 flush() 或缓冲区满时才发生
+struct SharedPtrReleaseBuffer {
+private:
+    static constexpr std::size_t _S_capacity = 32;
+
+    struct _Entry {
+        _SpCounter<_SpAtomicPolicy> *_M_owner;
+        long _M_count;
+    };
+
+    _Entry _M_entries[_S_capacity];
+    std::size_t _M_size = 0;
+
+public:
+    SharedPtrReleaseBuffer() noexcept = default;
+
+    SharedPtrReleaseBuffer(SharedPtrReleaseBuffer &&) = delete;
+
+    ~SharedPtrReleaseBuffer() noexcept {
+        flush();
+    }
+
+    template <class _Tp>
+    void defer(SharedPtr<_Tp> &&__ptr) noexcept {
+        _SpCounter<_SpAtomicPolicy> *__owner = std::exchange(__ptr._M_owner, nullptr);
+        __ptr._M_ptr = nullptr;
+        if (!__owner) {
+            return;
+        }
+        for (std::size_t __i = _M_size; __i != 0; --__i) { // 最近记录的最可能是同一个对象
+            if (_M_entries[__i - 1]._M_owner == __owner) {
+                ++_M_entries[__i - 1]._M_count;
+                return;
+            }
+        }
+        if (_M_size == _S_capacity) {
+            flush();
+        }
+        _M_entries[_M_size++] = {__owner, 1};
+    }
+
+    void flush() noexcept {
+        // 先清空再释放：析构对象时可能又会调用 defer
+        std::size_t __n = std::exchange(_M_size, 0);
+        _Entry __entries[_S_capacity];
+        std::copy_n(_M_entries, __n, __entries);
+        for (std::size_t __i = 0; __i != __n; ++__i) {
+            __entries[__i]._M_owner->_M_decref_n(__entries[__i]._M_count);
+        }
+    }
+};
+
+// 每个线程一个延迟释放缓冲区，线程退出时自动 flush
+inline SharedPtrReleaseBuffer &_S_threadReleaseBuffer() noexcept {
+    thread_local SharedPtrReleaseBuffer __buffer;
+    return __buffer;
+}
+
+template <class _Tp>
+void deferRelease(SharedPtr<_Tp> &&__ptr) noexcept {
+    _S_threadReleaseBuffer().defer(std::move(__ptr));
+}
+
+inline void flushDeferredReleases() noexcept {
+    _S_threadReleaseBuffer().flush();
+}
+
+// 可以被多个线程同时读写的 SharedPtr，读者与写者都不加锁（分离引用计数）
+// 当前值保存在一个堆上的节点 _Node 中，原子字的低 48 位是节点地址，高 16 位是“正在读取该节点的读者数”（外部计数）
+// 同时处于读取中的读者不能超过 65535 个
+// 读者：先对原子字 fetch_add 一次占住节点，再拷贝节点里的 SharedPtr，最后归还：若原子字仍指向该节点，直接把外部计数减回去
+// 写者：exchange 换上新节点后，把旧节点上尚未归还的外部计数转入节点自己的 _M_inner，之后归还的读者改为扣减 _M_inner，
+// 扣到 0 的一方负责释放旧节点；这样读者从不会访问到已经释放的节点
+template <class _Tp>
+struct AtomicSharedPtr {
+private:
+    static_assert(sizeof(void *) == 8, "AtomicSharedPtr packs a reader count into the upper pointer bits");
+
+    struct _Node {
+        SharedPtr<_Tp> _M_value;
+        std::atomic<long> _M_inner{0};
+    };
+
+    static constexpr std::uintptr_t _S_one = std::uintptr_t(1) << 48;
+    static constexpr std::uintptr_t _S_ptr_mask = _S_one - 1;
+
+    mutable std::atomic<std::uintptr_t> _M_word; // load() 也要修改其中的外部计数
+
+    static _Node *_S_node(std::uintptr_t __w) noexcept {
+        return reinterpret_cast<_Node *>(__w & _S_ptr_mask);
+    }
+
+    static std::uintptr_t _S_make(SharedPtr<_Tp> __value) {
+        if (!__value._M_owner) { // 空指针不需要节点
+            return 0;
+        }
+        return reinterpret_cast<std::uintptr_t>(new _Node{std::move(__value)});
+    }
+
+    // 占住当前节点，返回其地址（可能为空）
+    _Node *_M_acquire() const noexcept {
+        return _S_node(_M_word.fetch_add(_S_one, std::memory_order_acquire));
+    }
+
+    // 归还 _M_acquire 占住的节点
+    void _M_release(_Node *__node) const noexcept {
+        std::uintptr_t __w = _M_word.load(std::memory_order_relaxed);
+        while (_S_node(__w) == __node) {
+            if (_M_word.compare_exchange_weak(__w, __w - _S_one, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        // 节点已被换下，写者把我们的外部计数转入了 _M_inner
+        if (__node && __node->_M_inner.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete __node;
+        }
+    }
+
+    // 被换下的节点：转入尚未归还的外部计数 __outer，__extra 为调用者此后自己还持有的份数减去已计入 __outer 的份数
+    // 返回转入后的 _M_inner，它等于此后仍持有该节点的份数
+    static long _S_retire(_Node *__node, std::uintptr_t __outer, long __extra) noexcept {
+        long __n = long(__outer) + __extra;
+        return __node->_M_inner.fetch_add(__n, std::memory_order_acq_rel) + __n;
+    }
+
+    static void _S_unref(_Node *__node) noexcept {
+        if (__node->_M_inner.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete __node;
+        }
+    }
+
+public:
+    AtomicSharedPtr() noexcept : _M_word(0) {}
+
+    AtomicSharedPtr(SharedPtr<_Tp> __value) : _M_word(_S_make(std::move(__value))) {}
+
+    AtomicSharedPtr(AtomicSharedPtr const &) = delete;
+    AtomicSharedPtr &operator=(AtomicSharedPtr const &) = delete;
+
+    ~AtomicSharedPtr() noexcept {
+        delete _S_node(_M_word.load(std::memory_order_acquire));
+    }
+
+    static constexpr bool is_always_lock_free = true;
+
+    bool is_lock_free() const noexcept {
+        return true;
+    }
+
+    SharedPtr<_Tp> load() const noexcept {
+        _Node *__node = _M_acquire();
+        SharedPtr<_Tp> __ret;
+        if (__node) {
+            __ret = __node->_M_value;
+        }
+        _M_release(__node);
+        return __ret;
+    }
+
+    operator SharedPtr<_Tp>() const noexcept {
+        return load();
+    }
+
+    SharedPtr<_Tp> exchange(SharedPtr<_Tp> __desired) {
+        std::uintptr_t __old = _M_word.exchange(_S_make(std::move(__desired)), std::memory_order_acq_rel);
+        _Node *__node = _S_node(__old);
+        if (!__node) {
+            return nullptr;
+        }
+        SharedPtr<_Tp> __ret;
+        if (_S_retire(__node, __old >> 48, 1) == 1) { // 只剩自己，没有读者了，直接把值移出
+            __ret = std::move(__node->_M_value);
+            delete __node;
+        } else {
+            __ret = __node->_M_value;
+            _S_unref(__node);
+        }
+        return __ret;
+    }
+
+    void store(SharedPtr<_Tp> __desired) {
+        exchange(std::move(__desired));
+    }
+
+    AtomicSharedPtr &operator=(SharedPtr<_Tp> __desired) {
+        store(std::move(__desired));
+        return *this;
+    }
+
+    // 当前值与 __expected 指向同一对象且共享同一控制块时换成 __desired，否则把当前值写回 __expected
+    bool compare_exchange_strong(SharedPtr<_Tp> &__expected, SharedPtr<_Tp> __desired) {
+        std::uintptr_t __desired_word = 0;
+        bool __made = false;
+        for (;;) {
+            _Node *__node = _M_acquire();
+            SharedPtr<_Tp> const *__cur = __node ? &__node->_M_value : nullptr;
+            bool __equal = __cur ? __cur->get() == __expected.get() && __cur->owner_equal(__expected)
+                                 : !__expected.get() && !__expected._M_owner;
+            if (!__equal) {
+                __expected = __cur ? *__cur : nullptr;
+                _M_release(__node);
+                if (__made) {
+                    delete _S_node(__desired_word);
+                }
+                return false;
+            }
+            if (!__made) {
+                __desired_word = _S_make(std::move(__desired));
+                __made = true;
+            }
+            std::uintptr_t __w = _M_word.load(std::memory_order_relaxed);
+            while (_S_node(__w) == __node) {
+                if (_M_word.compare_exchange_weak(__w, __desired_word, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    // 外部计数里包含我们自己占住的那一份，转入时扣掉
+                    if (__node && _S_retire(__node, __w >> 48, -1) == 0) {
+                        delete __node;
+                    }
+                    return true;
+                }
+            }
+            _M_release(__node); // 期间被别人换掉了，重新比较
+        }
+    }
+
+    bool compare_exchange_weak(SharedPtr<_Tp> &__expected, SharedPtr<_Tp> __desired) {
+        return compare_exchange_strong(__expected, std::move(__desired));
+    }
+};
@@ -1,7 +1,670 @@
 #pragma once
 
 #include <cstddef>
+#include <cstring>
 #include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+#include <initializer_list>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <utility>
+#include "_Common.hpp"
+#include "_StringSearch.hpp"
 
 struct String {
+public:
+    using value_type = char;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = char *;
+    using const_pointer = char const *;
+    using reference = char &;
+    using const_reference = char const &;
+    using iterator = char *;
+    using const_iterator = char const *;
+    using reverse_iterator = std::reverse_iterator<char *>;
+    using const_reverse_iterator = std::reverse_iterator<char const *>;
+
+    static constexpr std::size_t npos = _S_str_npos;
+
+private:
+    static constexpr std::size_t _S_local_cap = 15; // 短字符串优化（SSO）：15 字节以内不分配内存
+
+    char *_M_data; // 总是指向以 '\0' 结尾的缓冲区：要么是 _M_local，要么是堆上的内存
+    std::size_t _M_size;
+    union {
+        std::size_t _M_cap; // 堆上缓冲区的容量（不含结尾的 '\0'）
+        char _M_local[_S_local_cap + 1];
+    };
+
+    bool _M_is_local() const noexcept {
+        return _M_data == _M_local;
+    }
+
+    static char *_S_allocate(std::size_t __cap) {
+        return static_cast<char *>(::operator new(__cap + 1));
+    }
+
+    void _M_dispose() noexcept {
+        if (!_M_is_local())
+            ::operator delete(_M_data);
+    }
+
+    void _M_init(char const *__s, std::size_t __n) {
+        if (__n > _S_local_cap) {
+            _M_data = _S_allocate(__n);
+            _M_cap = __n;
+        } else {
+            _M_data = _M_local;
+        }
+        if (__n != 0)
+            std::memcpy(_M_data, __s, __n);
+        _M_data[__n] = '\0';
+        _M_size = __n;
+    }
+
+    bool _M_aliases(char const *__s) const noexcept {
+        return std::less_equal<char const *>()(_M_data, __s) &&
+               std::less_equal<char const *>()(__s, _M_data + _M_size);
+    }
+
+    // 把 [__pos, __pos + __n1) 替换为 __n2 字节的未初始化空间，返回该空间的首地址
+    // 所有的插入、删除、追加、替换都基于这个函数
+    char *_M_splice(std::size_t __pos, std::size_t __n1, std::size_t __n2) {
+        std::size_t __new_size = _M_size - __n1 + __n2;
+        std::size_t __tail = _M_size - __pos - __n1;
+        if (__new_size <= capacity()) {
+            char *__p = _M_data + __pos;
+            if (__n1 != __n2)
+                std::memmove(__p + __n2, __p + __n1, __tail + 1);
+        } else {
+            std::size_t __new_cap = std::max(__new_size, capacity() * 2);
+            char *__new_data = _S_allocate(__new_cap);
+            std::memcpy(__new_data, _M_data, __pos);
+            std::memcpy(__new_data + __pos + __n2, _M_data + __pos + __n1, __tail + 1);
+            _M_dispose();
+            _M_data = __new_data;
+            _M_cap = __new_cap;
+        }
+        _M_size = __new_size;
+        return _M_data + __pos;
+    }
+
+    void _M_check_pos(std::size_t __pos) const {
+        if (__pos > _M_size) [[unlikely]]
+            _LIBPENGCXX_THROW_OUT_OF_RANGE(__pos, _M_size);
+    }
+
+    std::size_t _M_limit(std::size_t __pos, std::size_t __n) const noexcept {
+        return std::min(__n, _M_size - __pos);
+    }
+
+public:
+    String() noexcept : _M_data(_M_local), _M_size(0) {
+        _M_local[0] = '\0';
+    }
+
+    String(char const *__s) {
+        _M_init(__s, std::strlen(__s));
+    }
+
+    String(char const *__s, std::size_t __n) {
+        _M_init(__s, __n);
+    }
+
+    String(std::size_t __n, char __c) {
+        _M_data = _M_local;
+        _M_size = 0;
+        _M_local[0] = '\0';
+        std::memset(_M_splice(0, 0, __n), __c, __n);
+    }
+
+    explicit String(std::string_view __sv) {
+        _M_init(__sv.data(), __sv.size());
+    }
+
+    String(std::initializer_list<char> __ilist) {
+        _M_init(__ilist.begin(), __ilist.size());
+    }
+
+    template <_LIBPENGCXX_REQUIRES_ITERATOR_CATEGORY(std::input_iterator, _InputIt)>
+    String(_InputIt __first, _InputIt __last) : String() {
+        for (; __first != __last; ++__first)
+            push_back(*__first);
+    }
+
+    String(String const &__that) {
+        _M_init(__that._M_data, __that._M_size);
+    }
+
+    String(String &&__that) noexcept {
+        if (__that._M_is_local()) {
+            _M_data = _M_local;
+            std::memcpy(_M_local, __that._M_local, __that._M_size + 1);
+        } else {
+            _M_data = __that._M_data;
+            _M_cap = __that._M_cap;
+        }
+        _M_size = __that._M_size;
+        __that._M_data = __that._M_local;
+        __that._M_size = 0;
+        __that._M_local[0] = '\0';
+    }
+
+    String &operator=(String const &__that) {
+        if (this != &__that) [[likely]]
+            assign(__that._M_data, __that._M_size);
+        return *this;
+    }
+
+    String &operator=(String &&__that) noexcept {
+        if (this != &__that) [[likely]] {
+            _M_dispose();
+            new (this) String(std::move(__that));
+        }
+        return *this;
+    }
+
+    String &operator=(char const *__s) {
+        return assign(__s, std::strlen(__s));
+    }
+
+    String &operator=(std::string_view __sv) {
+        return assign(__sv.data(), __sv.size());
+    }
+
+    String &operator=(char __c) {
+        return assign(&__c, 1);
+    }
+
+    ~String() noexcept {
+        _M_dispose();
+    }
+
+    String &assign(char const *__s, std::size_t __n) {
+        return replace(0, _M_size, __s, __n);
+    }
+
+    String &assign(std::string_view __sv) {
+        return assign(__sv.data(), __sv.size());
+    }
+
+    String &assign(std::size_t __n, char __c) {
+        std::memset(_M_splice(0, _M_size, __n), __c, __n);
+        return *this;
+    }
+
+    operator std::string_view() const noexcept {
+        return std::string_view(_M_data, _M_size);
+    }
+
+    std::size_t size() const noexcept {
+        return _M_size;
+    }
+
+    std::size_t length() const noexcept {
+        return _M_size;
+    }
+
+    std::size_t capacity() const noexcept {
+        return _M_is_local() ? _S_local_cap : _M_cap;
+    }
+
+    bool empty() const noexcept {
+        return _M_size == 0;
+    }
+
+    static constexpr std::size_t max_size() noexcept {
+        return static_cast<std::size_t>(-1) / 2;
+    }
+
+    void reserve(std::size_t __n) {
+        if (__n <= capacity())
+            return;
+        char *__new_data = _S_allocate(__n);
+        std::memcpy(__new_data, _M_data, _M_size + 1);
+        _M_dispose();
+        _M_data = __new_data;
+        _M_cap = __n;
+    }
+
+    void shrink_to_fit() {
+        if (_M_is_local() || _M_cap == _M_size)
+            return;
+        String __tmp(_M_data, _M_size);
+        *this = std::move(__tmp);
+    }
+
+    void clear() noexcept {
+        _M_size = 0;
+        _M_data[0] = '\0';
+    }
+
+    void resize(std::size_t __n, char __c = '\0') {
+        if (__n <= _M_size) {
+            _M_size = __n;
+            _M_data[__n] = '\0';
+        } else {
+            std::size_t __old = _M_size;
+            std::memset(_M_splice(__old, 0, __n - __old), __c, __n - __old);
+        }
+    }
+
+    // 同 C++23 的 resize_and_overwrite：扩容到 __n 后把缓冲区交给 __op 直接写入，
+    // __op 返回实际写入的长度，避免先填零再覆盖的开销
+    // 按两倍扩容，这样反复在末尾追加时均摊 O(1)
+    template <class _Op>
+    void resize_and_overwrite(std::size_t __n, _Op __op) {
+        if (__n > capacity())
+            reserve(std::max(__n, capacity() * 2));
+        std::size_t __len = static_cast<std::size_t>(std::move(__op)(_M_data, __n));
+        _M_size = __len;
+        _M_data[__len] = '\0';
+    }
+
+    char const &operator[](std::size_t __i) const noexcept {
+        return _M_data[__i];
+    }
+
+    char &operator[](std::size_t __i) noexcept {
+        return _M_data[__i];
+    }
+
+    char const &at(std::size_t __i) const {
+        if (__i >= _M_size) [[unlikely]]
+            throw std::out_of_range("string::at");
+        return _M_data[__i];
+    }
+
+    char &at(std::size_t __i) {
+        if (__i >= _M_size) [[unlikely]]
+            throw std::out_of_range("string::at");
+        return _M_data[__i];
+    }
+
+    char const &front() const noexcept {
+        return _M_data[0];
+    }
+
+    char &front() noexcept {
+        return _M_data[0];
+    }
+
+    char const &back() const noexcept {
+        return _M_data[_M_size - 1];
+    }
+
+    char &back() noexcept {
+        return _M_data[_M_size - 1];
+    }
+
+    char const *data() const noexcept {
+        return _M_data;
+    }
+
+    char *data() noexcept {
+        return _M_data;
+    }
+
+    char const *c_str() const noexcept {
+        return _M_data;
+    }
+
+    char *begin() noexcept {
+        return _M_data;
+    }
+
+    char *end() noexcept {
+        return _M_data + _M_size;
+    }
+
+    char const *begin() const noexcept {
+        return _M_data;
+    }
+
+    char const *end() const noexcept {
+        return _M_data + _M_size;
+    }
+
+    char const *cbegin() const noexcept {
+        return _M_data;
+    }
+
+    char const *cend() const noexcept {
+        return _M_data + _M_size;
+    }
+
+    reverse_iterator rbegin() noexcept {
+        return reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rbegin() const noexcept {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const noexcept {
+        return const_reverse_iterator(begin());
+    }
+
+    const_reverse_iterator crbegin() const noexcept {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator crend() const noexcept {
+        return const_reverse_iterator(begin());
+    }
+
+    void push_back(char __c) {
+        if (_M_size == capacity()) [[unlikely]]
+            reserve(std::max(_M_size * 2, _S_local_cap * 2));
+        _M_data[_M_size] = __c;
+        _M_data[++_M_size] = '\0';
+    }
+
+    void pop_back() noexcept {
+        _M_data[--_M_size] = '\0';
+    }
+
+    String &append(char const *__s, std::size_t __n) {
+        return replace(_M_size, 0, __s, __n);
+    }
+
+    String &append(std::string_view __sv) {
+        return append(__sv.data(), __sv.size());
+    }
+
+    String &append(std::size_t __n, char __c) {
+        std::memset(_M_splice(_M_size, 0, __n), __c, __n);
+        return *this;
+    }
+
+    String &operator+=(std::string_view __sv) {
+        return append(__sv.data(), __sv.size());
+    }
+
+    String &operator+=(char const *__s) {
+        return append(__s, std::strlen(__s));
+    }
+
+    String &operator+=(char __c) {
+        push_back(__c);
+        return *this;
+    }
+
+    String &insert(std::size_t __pos, char const *__s, std::size_t __n) {
+        _M_check_pos(__pos);
+        return replace(__pos, 0, __s, __n);
+    }
+
+    String &insert(std::size_t __pos, std::string_view __sv) {
+        return insert(__pos, __sv.data(), __sv.size());
+    }
+
+    String &insert(std::size_t __pos, std::size_t __n, char __c) {
+        _M_check_pos(__pos);
+        std::memset(_M_splice(__pos, 0, __n), __c, __n);
+        return *this;
+    }
+
+    String &erase(std::size_t __pos = 0, std::size_t __n = npos) {
+        _M_check_pos(__pos);
+        _M_splice(__pos, _M_limit(__pos, __n), 0);
+        return *this;
+    }
+
+    char *erase(char const *__it) noexcept {
+        std::size_t __pos = __it - _M_data;
+        return _M_splice(__pos, 1, 0);
+    }
+
+    char *erase(char const *__first, char const *__last) noexcept {
+        std::size_t __pos = __first - _M_data;
+        return _M_splice(__pos, __last - __first, 0);
+    }
+
+    String &replace(std::size_t __pos, std::size_t __n1, char const *__s, std::size_t __n2) {
+        _M_check_pos(__pos);
+        __n1 = _M_limit(__pos, __n1);
+        if (__n2 != 0 && _M_aliases(__s)) [[unlikely]] { // 源字符串来自自身，先拷贝一份
+            String __tmp(__s, __n2);
+            std::memcpy(_M_splice(__pos, __n1, __n2), __tmp._M_data, __n2);
+            return *this;
+        }
+        char *__p = _M_splice(__pos, __n1, __n2);
+        if (__n2 != 0)
+            std::memcpy(__p, __s, __n2);
+        return *this;
+    }
+
+    String &replace(std::size_t __pos, std::size_t __n1, std::string_view __sv) {
+        return replace(__pos, __n1, __sv.data(), __sv.size());
+    }
+
+    String substr(std::size_t __pos = 0, std::size_t __n = npos) const {
+        _M_check_pos(__pos);
+        return String(_M_data + __pos, _M_limit(__pos, __n));
+    }
+
+    std::size_t copy(char *__dst, std::size_t __n, std::size_t __pos = 0) const {
+        _M_check_pos(__pos);
+        __n = _M_limit(__pos, __n);
+        std::memcpy(__dst, _M_data + __pos, __n);
+        return __n;
+    }
+
+    void swap(String &__that) noexcept {
+        String __tmp(std::move(__that));
+        __that = std::move(*this);
+        *this = std::move(__tmp);
+    }
+
+    int compare(std::string_view __sv) const noexcept {
+        return std::string_view(*this).compare(__sv);
+    }
+
+    bool starts_with(std::string_view __sv) const noexcept {
+        return std::string_view(*this).starts_with(__sv);
+    }
+
+    bool starts_with(char __c) const noexcept {
+        return _M_size != 0 && _M_data[0] == __c;
+    }
+
+    bool ends_with(std::string_view __sv) const noexcept {
+        return std::string_view(*this).ends_with(__sv);
+    }
+
+    bool ends_with(char __c) const noexcept {
+        return _M_size != 0 && _M_data[_M_size - 1] == __c;
+    }
+
+    bool contains(std::string_view __sv) const noexcept {
+        return find(__sv) != npos;
+    }
+
+    bool contains(char __c) const noexcept {
+        return find(__c) != npos;
+    }
+
+    // 查找函数的语义与 std::string 相同，具体算法见 _StringSearch.hpp
+    std::size_t find(char __c, std::size_t __pos = 0) const noexcept {
+        if (__pos >= _M_size)
+            return npos;
+        std::size_t __r = _S_str_find_char(_M_data + __pos, _M_size - __pos, __c);
+        return __r == npos ? npos : __r + __pos;
+    }
+
+    std::size_t find(char const *__s, std::size_t __pos, std::size_t __n) const noexcept {
+        if (__pos > _M_size)
+            return npos;
+        std::size_t __r = _S_str_find(_M_data + __pos, _M_size - __pos, __s, __n);
+        return __r == npos ? npos : __r + __pos;
+    }
+
+    std::size_t find(std::string_view __sv, std::size_t __pos = 0) const noexcept {
+        return find(__sv.data(), __pos, __sv.size());
+    }
+
+    std::size_t rfind(char __c, std::size_t __pos = npos) const noexcept {
+        std::size_t __len = __pos < _M_size ? __pos + 1 : _M_size;
+        return _S_str_rfind_char(_M_data, __len, __c);
+    }
+
+    std::size_t rfind(char const *__s, std::size_t __pos, std::size_t __n) const noexcept {
+        if (__n > _M_size)
+            return npos;
+        std::size_t __len = std::min(__pos, _M_size - __n) + __n;
+        return _S_str_rfind(_M_data, __len, __s, __n);
+    }
+
+    std::size_t rfind(std::string_view __sv, std::size_t __pos = npos) const noexcept {
+        return rfind(__sv.data(), __pos, __sv.size());
+    }
+
+    std::size_t find_first_of(char const *__s, std::size_t __pos, std::size_t __n) const noexcept {
+        if (__pos >= _M_size || __n == 0)
+            return npos;
+        std::size_t __r = _S_str_find_set<false>(_M_data + __pos, _M_size - __pos, __s, __n);
+        return __r == npos ? npos : __r + __pos;
+    }
+
+    std::size_t find_first_of(std::string_view __sv, std::size_t __pos = 0) const noexcept {
+        return find_first_of(__sv.data(), __pos, __sv.size());
+    }
+
+    std::size_t find_first_of(char __c, std::size_t __pos = 0) const noexcept {
+        return find(__c, __pos);
+    }
+
+    std::size_t find_first_not_of(char const *__s, std::size_t __pos, std::size_t __n) const noexcept {
+        if (__pos >= _M_size)
+            return npos;
+        std::size_t __r = _S_str_find_set<true>(_M_data + __pos, _M_size - __pos, __s, __n);
+        return __r == npos ? npos : __r + __pos;
+    }
+
+    std::size_t find_first_not_of(std::string_view __sv, std::size_t __pos = 0) const noexcept {
+        return find_first_not_of(__sv.data(), __pos, __sv.size());
+    }
+
+    std::size_t find_first_not_of(char __c, std::size_t __pos = 0) const noexcept {
+        return find_first_not_of(&__c, __pos, 1);
+    }
+
+    std::size_t find_last_of(char const *__s, std::size_t __pos, std::size_t __n) const noexcept {
+        if (__n == 0)
+            return npos;
+        std::size_t __len = __pos < _M_size ? __pos + 1 : _M_size;
+        return _S_str_rfind_set<false>(_M_data, __len, __s, __n);
+    }
+
+    std::size_t find_last_of(std::string_view __sv, std::size_t __pos = npos) const noexcept {
+        return find_last_of(__sv.data(), __pos, __sv.size());
+    }
+
+    std::size_t find_last_of(char __c, std::size_t __pos = npos) const noexcept {
+        return rfind(__c, __pos);
+    }
+
+    std::size_t find_last_not_of(char const *__s, std::size_t __pos, std::size_t __n) const noexcept {
+        std::size_t __len = __pos < _M_size ? __pos + 1 : _M_size;
+        return _S_str_rfind_set<true>(_M_data, __len, __s, __n);
+    }
+
+    std::size_t find_last_not_of(std::string_view __sv, std::size_t __pos = npos) const noexcept {
+        return find_last_not_of(__sv.data(), __pos, __sv.size());
+    }
+
+    std::size_t find_last_not_of(char __c, std::size_t __pos = npos) const noexcept {
+        return find_last_not_of(&__c, __pos, 1);
+    }
+
+    friend bool operator==(String const &__lhs, std::string_view __rhs) noexcept {
+        return __lhs._M_size == __rhs.size() &&
+               std::memcmp(__lhs._M_data, __rhs.data(), __lhs._M_size) == 0;
+    }
+
+#if __cpp_lib_three_way_comparison
+    friend std::strong_ordering operator<=>(String const &__lhs, std::string_view __rhs) noexcept {
+        return std::string_view(__lhs) <=> __rhs;
+    }
+#else
+    friend bool operator!=(String const &__lhs, std::string_view __rhs) noexcept {
+        return !(__lhs == __rhs);
+    }
+
+    friend bool operator<(String const &__lhs, std::string_view __rhs) noexcept {
+        return __lhs.compare(__rhs) < 0;
+    }
+
+    friend bool operator>(String const &__lhs, std::string_view __rhs) noexcept {
+        return __lhs.compare(__rhs) > 0;
+    }
+
+    friend bool operator<=(String const &__lhs, std::string_view __rhs) noexcept {
+        return __lhs.compare(__rhs) <= 0;
+    }
+
+    friend bool operator>=(String const &__lhs, std::string_view __rhs) noexcept {
+        return __lhs.compare(__rhs) >= 0;
+    }
+#endif
+
+    friend String operator+(String const &__lhs, String const &__rhs) {
+        String __res;
+        __res.reserve(__lhs._M_size + __rhs._M_size);
+        __res.append(__lhs.data(), __lhs.size());
+        __res.append(__rhs.data(), __rhs.size());
+        return __res;
+    }
+
+    friend String operator+(String const &__lhs, std::string_view __rhs) {
+        String __res;
+        __res.reserve(__lhs._M_size + __rhs.size());
+        __res.append(__lhs.data(), __lhs.size());
+        __res.append(__rhs.data(), __rhs.size());
+        return __res;
+    }
+
+    friend String operator+(std::string_view __lhs, String const &__rhs) {
+        String __res;
+        __res.reserve(__lhs.size() + __rhs._M_size);
+        __res.append(__lhs.data(), __lhs.size());
+        __res.append(__rhs.data(), __rhs.size());
+        return __res;
+    }
+
+    friend String operator+(String &&__lhs, std::string_view __rhs) {
+        __lhs.append(__rhs.data(), __rhs.size());
+        return std::move(__lhs);
+    }
+
+    friend String operator+(String const &__lhs, char __rhs) {
+        String __res(__lhs);
+        __res.push_back(__rhs);
+        return __res;
+    }
+
+    friend String operator+(String &&__lhs, char __rhs) {
+        __lhs.push_back(__rhs);
+        return std::move(__lhs);
+    }
+
+    friend std::ostream &operator<<(std::ostream &__os, String const &__s) {
+        return __os << std::string_view(__s);
+    }
+};
+
+template <>
+struct std::hash<String> {
+    std::size_t operator()(String const &__s) const noexcept {
+        return std::hash<std::string_view>()(__s);
+    }
 };
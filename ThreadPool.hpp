@@ -0,0 +1,496 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <utility>
+#include "Functional.hpp"
+#include "SharedPtr.hpp"
+#include "UniquePtr.hpp"
+#include "Vector.hpp"
+
+// 工作窃取线程池：每个工作线程有自己的 Chase-Lev 双端队列，外部线程提交的任务进入一个全局的无锁注入队列
+// 工作线程先从自己队列的底部取任务（后进先出，缓存友好），没有时再从注入队列取，再没有就从其他线程队列的顶部窃取
+// 全都没有时在 std::atomic::wait 上休眠（Linux 上 libstdc++ 以 futex 实现），提交任务时只在有线程休眠时才唤醒
+
+struct _ThreadPoolTask {
+    MoveOnlyFunction<void()> _M_fn;
+    _ThreadPoolTask *_M_next = nullptr; // 空闲时串成链表
+};
+
+// 任务节点的回收：执行完的节点放回执行线程自己的缓存，提交时先从本线程的缓存取
+// 这样稳定运行时不再每个任务都在一个线程 new、另一个线程 delete，避免争用全局分配器
+// 本地缓存超过上限时把一半交给全局链表，本地取空时一次取走全局链表上的全部节点
+// 全局链表只会被整体取走，不会单独摘下某个节点，所以 CAS 压入没有 ABA 问题
+struct _ThreadPoolTaskCache {
+private:
+    static constexpr std::size_t _S_capacity = 256;
+
+    _ThreadPoolTask *_M_head = nullptr;
+    std::size_t _M_size = 0;
+
+    struct _Global {
+        std::atomic<_ThreadPoolTask *> _M_head{nullptr};
+
+        ~_Global() {
+            _S_delete_list(_M_head.load(std::memory_order_acquire));
+        }
+    };
+
+    static _Global &_S_global() noexcept {
+        static _Global __global;
+        return __global;
+    }
+
+    static _ThreadPoolTaskCache &_S_local() noexcept {
+        static thread_local _ThreadPoolTaskCache __cache;
+        return __cache;
+    }
+
+    static void _S_delete_list(_ThreadPoolTask *__p) noexcept {
+        while (__p)
+            delete std::exchange(__p, __p->_M_next);
+    }
+
+    // 摘下后一半节点压入全局链表
+    void _M_spill() noexcept {
+        _ThreadPoolTask *__last = _M_head;
+        for (std::size_t __i = 1; __i != _S_capacity / 2; ++__i)
+            __last = __last->_M_next;
+        _ThreadPoolTask *__first = std::exchange(__last->_M_next, nullptr);
+        _ThreadPoolTask *__tail = __first;
+        while (__tail->_M_next)
+            __tail = __tail->_M_next;
+        _M_size = _S_capacity / 2;
+        auto &__global = _S_global()._M_head;
+        __tail->_M_next = __global.load(std::memory_order_relaxed);
+        while (!__global.compare_exchange_weak(__tail->_M_next, __first, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    void _M_refill() noexcept {
+        _M_head = _S_global()._M_head.exchange(nullptr, std::memory_order_acquire);
+        _M_size = 0;
+        for (_ThreadPoolTask *__p = _M_head; __p; __p = __p->_M_next)
+            ++_M_size;
+    }
+
+public:
+    _ThreadPoolTaskCache() = default;
+    _ThreadPoolTaskCache(_ThreadPoolTaskCache &&) = delete;
+
+    ~_ThreadPoolTaskCache() {
+        _S_delete_list(_M_head);
+    }
+
+    static _ThreadPoolTask *_S_allocate(MoveOnlyFunction<void()> &&__fn) {
+        _ThreadPoolTaskCache &__cache = _S_local();
+        if (!__cache._M_head)
+            __cache._M_refill();
+        if (_ThreadPoolTask *__task = __cache._M_head) {
+            __cache._M_head = __task->_M_next;
+            --__cache._M_size;
+            __task->_M_fn = std::move(__fn);
+            return __task;
+        }
+        return new _ThreadPoolTask{std::move(__fn)};
+    }
+
+    static void _S_recycle(_ThreadPoolTask *__task) noexcept {
+        __task->_M_fn = nullptr;
+        _ThreadPoolTaskCache &__cache = _S_local();
+        __task->_M_next = __cache._M_head;
+        __cache._M_head = __task;
+        if (++__cache._M_size > _S_capacity)
+            __cache._M_spill();
+    }
+};
+
+// Chase-Lev 工作窃取双端队列（Lê, Pop, Cohen, Nardelli: Correct and Efficient Work-Stealing for Weak Memory Models）
+// 只有所属的工作线程在底部 push / take，其他线程只在顶部 steal
+// 容量不足时翻倍；旧的缓冲区可能仍被窃取者读取，保留到队列析构时才释放
+struct _WorkStealingDeque {
+private:
+    struct _Buffer {
+        std::int64_t _M_mask;
+        UniquePtr<std::atomic<_ThreadPoolTask *>[]> _M_slots;
+
+        explicit _Buffer(std::int64_t __cap) : _M_mask(__cap - 1), _M_slots(new std::atomic<_ThreadPoolTask *>[__cap]) {}
+
+        _ThreadPoolTask *_M_get(std::int64_t __i) noexcept {
+            return _M_slots[__i & _M_mask].load(std::memory_order_relaxed);
+        }
+
+        void _M_put(std::int64_t __i, _ThreadPoolTask *__task) noexcept {
+            _M_slots[__i & _M_mask].store(__task, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(64) std::atomic<std::int64_t> _M_top{0};
+    alignas(64) std::atomic<std::int64_t> _M_bottom{0};
+    std::atomic<_Buffer *> _M_buffer;
+    Vector<UniquePtr<_Buffer>> _M_buffers; // 所有分配过的缓冲区，只由所属线程修改
+
+    _Buffer *_M_grow(_Buffer *__old, std::int64_t __top, std::int64_t __bottom) {
+        _M_buffers.push_back(makeUnique<_Buffer>((__old->_M_mask + 1) * 2));
+        _Buffer *__buf = _M_buffers.back().get();
+        for (std::int64_t __i = __top; __i != __bottom; ++__i)
+            __buf->_M_put(__i, __old->_M_get(__i));
+        _M_buffer.store(__buf, std::memory_order_release);
+        return __buf;
+    }
+
+public:
+    explicit _WorkStealingDeque(std::int64_t __cap = 256) {
+        _M_buffers.push_back(makeUnique<_Buffer>(__cap));
+        _M_buffer.store(_M_buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    // 仅所属线程调用
+    void push(_ThreadPoolTask *__task) {
+        std::int64_t __b = _M_bottom.load(std::memory_order_relaxed);
+        std::int64_t __t = _M_top.load(std::memory_order_acquire);
+        _Buffer *__buf = _M_buffer.load(std::memory_order_relaxed);
+        if (__b - __t > __buf->_M_mask) [[unlikely]]
+            __buf = _M_grow(__buf, __t, __b);
+        __buf->_M_put(__b, __task);
+        _M_bottom.store(__b + 1, std::memory_order_release);
+    }
+
+    // 仅所属线程调用，队列为空时返回 nullptr
+    _ThreadPoolTask *take() noexcept {
+        std::int64_t __b = _M_bottom.load(std::memory_order_relaxed) - 1;
+        _Buffer *__buf = _M_buffer.load(std::memory_order_relaxed);
+        _M_bottom.store(__b, std::memory_order_seq_cst); // 先声明要取走 __b，再看顶部，与 steal 互相可见
+        std::int64_t __t = _M_top.load(std::memory_order_seq_cst);
+        if (__t > __b) { // 队列为空
+            _M_bottom.store(__b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        _ThreadPoolTask *__task = __buf->_M_get(__b);
+        if (__t == __b) { // 只剩最后一个，与窃取者竞争
+            if (!_M_top.compare_exchange_strong(__t, __t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                __task = nullptr;
+            _M_bottom.store(__b + 1, std::memory_order_relaxed);
+        }
+        return __task;
+    }
+
+    // 任意线程调用，队列为空或与其他线程竞争失败时返回 nullptr
+    _ThreadPoolTask *steal() noexcept {
+        std::int64_t __t = _M_top.load(std::memory_order_seq_cst);
+        std::int64_t __b = _M_bottom.load(std::memory_order_seq_cst);
+        if (__t >= __b)
+            return nullptr;
+        _Buffer *__buf = _M_buffer.load(std::memory_order_acquire);
+        _ThreadPoolTask *__task = __buf->_M_get(__t);
+        if (!_M_top.compare_exchange_strong(__t, __t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return __task;
+    }
+
+    bool empty() const noexcept {
+        return _M_top.load(std::memory_order_relaxed) >= _M_bottom.load(std::memory_order_relaxed);
+    }
+};
+
+// 有界多生产者多消费者队列（Dmitry Vyukov 的环形缓冲区算法），每个槽位的序号决定该槽位当前轮到谁
+struct _InjectionQueue {
+private:
+    struct _Cell {
+        std::atomic<std::size_t> _M_seq;
+        _ThreadPoolTask *_M_task;
+    };
+
+    std::size_t _M_mask;
+    UniquePtr<_Cell[]> _M_cells;
+    alignas(64) std::atomic<std::size_t> _M_enqueue_pos{0};
+    alignas(64) std::atomic<std::size_t> _M_dequeue_pos{0};
+
+public:
+    explicit _InjectionQueue(std::size_t __cap) : _M_mask(__cap - 1), _M_cells(new _Cell[__cap]) {
+        for (std::size_t __i = 0; __i != __cap; ++__i)
+            _M_cells[__i]._M_seq.store(__i, std::memory_order_relaxed);
+    }
+
+    // 队列已满时返回 false
+    bool push(_ThreadPoolTask *__task) noexcept {
+        std::size_t __pos = _M_enqueue_pos.load(std::memory_order_relaxed);
+        _Cell *__cell;
+        for (;;) {
+            __cell = &_M_cells[__pos & _M_mask];
+            std::size_t __seq = __cell->_M_seq.load(std::memory_order_acquire);
+            auto __diff = static_cast<std::ptrdiff_t>(__seq - __pos);
+            if (__diff == 0) {
+                if (_M_enqueue_pos.compare_exchange_weak(__pos, __pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (__diff < 0) {
+                return false;
+            } else {
+                __pos = _M_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        __cell->_M_task = __task;
+        __cell->_M_seq.store(__pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队列为空时返回 nullptr
+    _ThreadPoolTask *pop() noexcept {
+        std::size_t __pos = _M_dequeue_pos.load(std::memory_order_relaxed);
+        _Cell *__cell;
+        for (;;) {
+            __cell = &_M_cells[__pos & _M_mask];
+            std::size_t __seq = __cell->_M_seq.load(std::memory_order_acquire);
+            auto __diff = static_cast<std::ptrdiff_t>(__seq - (__pos + 1));
+            if (__diff == 0) {
+                if (_M_dequeue_pos.compare_exchange_weak(__pos, __pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (__diff < 0) {
+                return nullptr;
+            } else {
+                __pos = _M_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        _ThreadPoolTask *__task = __cell->_M_task;
+        __cell->_M_seq.store(__pos + _M_mask + 1, std::memory_order_release);
+        return __task;
+    }
+};
+
+struct ThreadPool {
+private:
+    static constexpr std::size_t _S_injection_capacity = 1 << 14;
+
+    struct _Worker {
+        _WorkStealingDeque _M_deque;
+        std::thread _M_thread;
+        std::uint32_t _M_rng = 0; // 选择窃取对象用的随机数
+    };
+
+    UniquePtr<_Worker[]> _M_workers;
+    std::size_t _M_count;
+    _InjectionQueue _M_injection;
+    alignas(64) std::atomic<std::uint32_t> _M_wake_epoch{0}; // 休眠的线程在此等待，唤醒时递增
+    alignas(64) std::atomic<std::size_t> _M_sleepers{0};
+    std::atomic<bool> _M_wake_pending{false}; // 已有一次唤醒尚未被响应时，后续提交不必再发起系统调用
+    std::atomic<bool> _M_stopping{false};
+
+    // parallel_for 的完成状态：由调用者与每个分段共同持有
+    // 最后一个分段减到 0 之后还要 notify_all，调用者此时可能已经返回，所以不能放在调用者的栈上
+    struct _ParallelForState {
+        std::atomic<std::size_t> _M_remaining;
+        std::atomic<bool> _M_failed{false};
+        std::exception_ptr _M_error;
+
+        explicit _ParallelForState(std::size_t __chunks) noexcept : _M_remaining(__chunks) {}
+    };
+
+    // 当前线程所属的线程池与工作线程编号，外部线程为 nullptr
+    static ThreadPool *&_S_current_pool() noexcept {
+        static thread_local ThreadPool *__pool = nullptr;
+        return __pool;
+    }
+
+    static std::size_t &_S_current_index() noexcept {
+        static thread_local std::size_t __index = 0;
+        return __index;
+    }
+
+    _Worker *_M_current_worker() noexcept {
+        return _S_current_pool() == this ? &_M_workers[_S_current_index()] : nullptr;
+    }
+
+    void _M_push(_ThreadPoolTask *__task) {
+        if (_Worker *__w = _M_current_worker()) {
+            __w->_M_deque.push(__task);
+            return;
+        }
+        while (!_M_injection.push(__task)) [[unlikely]] { // 注入队列已满：让出 CPU 等工作线程消化，起到背压作用
+            _M_notify(_M_count);
+            std::this_thread::yield();
+        }
+    }
+
+    // 与 _M_park 配对：先发布任务，再检查有无休眠线程，两边都用 seq_cst 保证不会错过唤醒
+    // 一次只唤醒一个线程，被唤醒者取到任务后再唤醒下一个（见 _M_find_task），避免大量提交时每次都进入内核
+    void _M_notify(std::size_t __n) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_M_sleepers.load(std::memory_order_seq_cst) == 0)
+            return;
+        if (__n == 1 && _M_wake_pending.exchange(true, std::memory_order_seq_cst))
+            return;
+        _M_wake_epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (__n == 1)
+            _M_wake_epoch.notify_one();
+        else
+            _M_wake_epoch.notify_all();
+    }
+
+    _ThreadPoolTask *_M_find_task(std::size_t __self) noexcept {
+        if (__self < _M_count) {
+            if (_ThreadPoolTask *__task = _M_workers[__self]._M_deque.take())
+                return __task;
+        }
+        // 从共享的队列中取到任务，说明可能还有积压，唤醒一个同伴来分担
+        if (_ThreadPoolTask *__task = _M_injection.pop()) {
+            _M_notify(1);
+            return __task;
+        }
+        // 从随机位置开始依次尝试窃取其他线程
+        std::size_t __start = 0;
+        if (__self < _M_count) {
+            std::uint32_t &__rng = _M_workers[__self]._M_rng;
+            __rng = __rng * 1664525u + 1013904223u;
+            __start = __rng % _M_count;
+        }
+        for (std::size_t __k = 0; __k != _M_count; ++__k) {
+            std::size_t __victim = (__start + __k) % _M_count;
+            if (__victim == __self)
+                continue;
+            if (_ThreadPoolTask *__task = _M_workers[__victim]._M_deque.steal()) {
+                _M_notify(1);
+                return __task;
+            }
+        }
+        return nullptr;
+    }
+
+    // 任务抛出的异常无处传递，与 std::thread 一样调用 std::terminate；parallel_for 的分段自己捕获异常，不会走到这里
+    static void _S_run(_ThreadPoolTask *__task) noexcept {
+        __task->_M_fn();
+        _ThreadPoolTaskCache::_S_recycle(__task);
+    }
+
+    void _M_park(std::size_t __self) {
+        std::uint32_t __epoch = _M_wake_epoch.load(std::memory_order_seq_cst);
+        _M_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        // 清除唤醒标记：此后看到标记仍为 true 而跳过唤醒的提交者，其任务一定能被下面的检查看到
+        _M_wake_pending.store(false, std::memory_order_seq_cst);
+        // 登记休眠之后再确认一次没有任务，否则可能错过在登记之前提交、却没看到休眠者而未唤醒的任务
+        _ThreadPoolTask *__task = _M_find_task(__self);
+        if (!__task && !_M_stopping.load(std::memory_order_acquire))
+            _M_wake_epoch.wait(__epoch, std::memory_order_seq_cst);
+        _M_sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        _M_wake_pending.store(false, std::memory_order_seq_cst); // 醒来的线程会去找任务，此后的提交需要重新唤醒
+        if (__task)
+            _S_run(__task);
+    }
+
+    // 在等待 __done 变为 true 期间，当前线程若是本池的工作线程，就帮忙执行任务，避免所有工作线程都在等待而死锁
+    template <class _Pred>
+    void _M_help_until(_Pred __done) {
+        _Worker *__w = _M_current_worker();
+        std::size_t __self = __w ? _S_current_index() : _M_count;
+        while (!__done()) {
+            if (_ThreadPoolTask *__task = _M_find_task(__self))
+                _S_run(__task);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void _M_worker_main(std::size_t __self) {
+        _S_current_pool() = this;
+        _S_current_index() = __self;
+        for (;;) {
+            if (_ThreadPoolTask *__task = _M_find_task(__self)) {
+                _S_run(__task);
+                continue;
+            }
+            if (_M_stopping.load(std::memory_order_acquire))
+                break; // 已无任务且正在析构
+            _M_park(__self);
+        }
+    }
+
+public:
+    explicit ThreadPool(std::size_t __threads = std::thread::hardware_concurrency())
+        : _M_workers(new _Worker[__threads ? __threads : 1])
+        , _M_count(__threads ? __threads : 1)
+        , _M_injection(_S_injection_capacity) {
+        for (std::size_t __i = 0; __i != _M_count; ++__i) {
+            _M_workers[__i]._M_rng = static_cast<std::uint32_t>(__i * 2654435761u + 1);
+            _M_workers[__i]._M_thread = std::thread(&ThreadPool::_M_worker_main, this, __i);
+        }
+    }
+
+    ThreadPool(ThreadPool &&) = delete;
+
+    // 先执行完所有已提交的任务，再结束工作线程
+    ~ThreadPool() {
+        _M_stopping.store(true, std::memory_order_release);
+        _M_wake_epoch.fetch_add(1, std::memory_order_seq_cst);
+        _M_wake_epoch.notify_all();
+        for (std::size_t __i = 0; __i != _M_count; ++__i)
+            _M_workers[__i]._M_thread.join();
+    }
+
+    std::size_t size() const noexcept {
+        return _M_count;
+    }
+
+    // 在工作线程中提交的任务放入该线程自己的队列，否则放入注入队列
+    void submit(MoveOnlyFunction<void()> __fn) {
+        _M_push(_ThreadPoolTaskCache::_S_allocate(std::move(__fn)));
+        _M_notify(1);
+    }
+
+    // 一次提交多个任务，最后只唤醒一次
+    void bulk_submit(Vector<MoveOnlyFunction<void()>> __fns) {
+        for (auto &__fn : __fns)
+            _M_push(_ThreadPoolTaskCache::_S_allocate(std::move(__fn)));
+        _M_notify(__fns.size());
+    }
+
+    // 把 [0, __n) 切成若干段并行执行 __body(__begin, __end)，所有段完成后才返回
+    // 某一段抛出异常时，尚未开始的段不再执行，等所有段结束后在调用者线程重新抛出第一个异常
+    // 分段引用着调用者栈上的 __body，所以无论是否出错都要等到所有段都调用完 __body 才能返回
+    template <class _Body>
+    void parallel_for(std::size_t __n, std::size_t __grain, _Body const &__body) {
+        if (__n == 0)
+            return;
+        if (__grain == 0)
+            __grain = (__n + _M_count * 4 - 1) / (_M_count * 4);
+        std::size_t __chunks = (__n + __grain - 1) / __grain;
+        auto __state = makeShared<_ParallelForState>(__chunks);
+        Vector<MoveOnlyFunction<void()>> __fns;
+        __fns.reserve(__chunks);
+        for (std::size_t __begin = 0; __begin < __n; __begin += __grain) {
+            std::size_t __end = __n - __begin < __grain ? __n : __begin + __grain;
+            __fns.push_back([&__body, __state, __begin, __end] {
+                if (!__state->_M_failed.load(std::memory_order_relaxed)) {
+                    try {
+                        __body(__begin, __end);
+                    } catch (...) {
+                        if (!__state->_M_failed.exchange(true, std::memory_order_relaxed))
+                            __state->_M_error = std::current_exception(); // 由下面 acq_rel 的减法发布给调用者
+                    }
+                }
+                if (__state->_M_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    __state->_M_remaining.notify_all();
+            });
+        }
+        bulk_submit(std::move(__fns));
+        std::atomic<std::size_t> &__remaining = __state->_M_remaining;
+        if (_M_current_worker()) {
+            _M_help_until([&] { return __remaining.load(std::memory_order_acquire) == 0; });
+        } else {
+            for (std::size_t __r; (__r = __remaining.load(std::memory_order_acquire)) != 0; )
+                __remaining.wait(__r, std::memory_order_acquire);
+        }
+        if (__state->_M_error)
+            std::rethrow_exception(__state->_M_error);
+    }
+
+    // 对 Vector 中的每个元素并行执行 __fn(__elem)
+    template <class _Tp, class _Fn>
+    void parallel_for(Vector<_Tp> &__v, _Fn const &__fn, std::size_t __grain = 0) {
+        _Tp *__data = __v.data();
+        parallel_for(__v.size(), __grain, [__data, &__fn] (std::size_t __begin, std::size_t __end) {
+            for (std::size_t __i = __begin; __i != __end; ++__i)
+                __fn(__data[__i]);
+        });
+    }
+};
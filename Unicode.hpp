@@ -0,0 +1,433 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include "Optional.hpp"
+#include "String.hpp"
+#include "Vector.hpp"
+
+// UTF-8 校验与 UTF-8 / UTF-16 / UTF-32 之间的转换
+// 校验有两个版本：逐字节的标量实现，以及一次处理 32 字节的 AVX2 实现（Keiser & Lemire 的查表算法）
+// 运行时检测 CPU 是否支持 AVX2，第一次调用时选定实现，之后都通过同一个函数指针调用
+// 转换函数先校验，再在“输入一定合法”的前提下解码；统计长度与扩展连续的 ASCII 字节用 SSE2 每次处理 16 字节
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define _LIBPENGCXX_UTF8_AVX2 1
+#define _LIBPENGCXX_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+inline std::uint64_t _S_load8(unsigned char const *__p) noexcept {
+    std::uint64_t __w;
+    std::memcpy(&__w, __p, 8);
+    return __w;
+}
+
+inline bool _S_is_ascii8(unsigned char const *__p) noexcept {
+    return (_S_load8(__p) & 0x8080808080808080ull) == 0;
+}
+
+inline bool _S_utf8_validate_scalar(char const *__s, std::size_t __n) noexcept {
+    auto const *__p = reinterpret_cast<unsigned char const *>(__s);
+    std::size_t __i = 0;
+    while (__i < __n) {
+        if (__i + 8 <= __n && _S_is_ascii8(__p + __i)) {
+            __i += 8;
+            continue;
+        }
+        unsigned __c = __p[__i];
+        if (__c < 0x80) {
+            ++__i;
+            continue;
+        }
+        std::size_t __len;
+        std::uint32_t __cp, __min;
+        if ((__c & 0xe0) == 0xc0) {
+            __len = 2, __cp = __c & 0x1f, __min = 0x80;
+        } else if ((__c & 0xf0) == 0xe0) {
+            __len = 3, __cp = __c & 0x0f, __min = 0x800;
+        } else if ((__c & 0xf8) == 0xf0) {
+            __len = 4, __cp = __c & 0x07, __min = 0x10000;
+        } else {
+            return false; // 孤立的后续字节，或 0xf8 以上的非法首字节
+        }
+        if (__n - __i < __len)
+            return false;
+        for (std::size_t __k = 1; __k < __len; ++__k) {
+            unsigned __b = __p[__i + __k];
+            if ((__b & 0xc0) != 0x80)
+                return false;
+            __cp = (__cp << 6) | (__b & 0x3f);
+        }
+        if (__cp < __min || __cp > 0x10ffff || (__cp >= 0xd800 && __cp <= 0xdfff))
+            return false; // 超长编码、超出 Unicode 范围、代理区
+        __i += __len;
+    }
+    return true;
+}
+
+#if _LIBPENGCXX_UTF8_AVX2
+// 每个字节与它前面 1~3 个字节组成的组合，用三张 16 项的表按半字节查出“可能的错误类型”，三者相与即为真正的错误
+// 详见 John Keiser, Daniel Lemire: Validating UTF-8 In Less Than One Instruction Per Byte
+enum : std::uint8_t {
+    _S_utf8_too_short = 1 << 0,   // 11______ 0_______ 或 11______ 11______
+    _S_utf8_too_long = 1 << 1,    // 0_______ 10______
+    _S_utf8_overlong_3 = 1 << 2,  // 11100000 100_____
+    _S_utf8_too_large = 1 << 3,   // 11110100 1001____ 及更大
+    _S_utf8_surrogate = 1 << 4,   // 11101101 101_____
+    _S_utf8_overlong_2 = 1 << 5,  // 1100000_ 10______
+    _S_utf8_too_large_1000 = 1 << 6, // 11110101 1000____ 及更大
+    _S_utf8_overlong_4 = 1 << 6,  // 11110000 1000____
+    _S_utf8_two_conts = 1 << 7,   // 10______ 10______
+    _S_utf8_carry = _S_utf8_too_short | _S_utf8_too_long | _S_utf8_two_conts,
+};
+
+inline constexpr std::uint8_t _S_utf8_byte1_high[16] = {
+    _S_utf8_too_long, _S_utf8_too_long, _S_utf8_too_long, _S_utf8_too_long,
+    _S_utf8_too_long, _S_utf8_too_long, _S_utf8_too_long, _S_utf8_too_long,
+    _S_utf8_two_conts, _S_utf8_two_conts, _S_utf8_two_conts, _S_utf8_two_conts,
+    _S_utf8_too_short | _S_utf8_overlong_2,
+    _S_utf8_too_short,
+    _S_utf8_too_short | _S_utf8_overlong_3 | _S_utf8_surrogate,
+    _S_utf8_too_short | _S_utf8_too_large | _S_utf8_too_large_1000 | _S_utf8_overlong_4,
+};
+
+inline constexpr std::uint8_t _S_utf8_byte1_low[16] = {
+    _S_utf8_carry | _S_utf8_overlong_3 | _S_utf8_overlong_2 | _S_utf8_overlong_4,
+    _S_utf8_carry | _S_utf8_overlong_2,
+    _S_utf8_carry,
+    _S_utf8_carry,
+    _S_utf8_carry | _S_utf8_too_large,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000 | _S_utf8_surrogate,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+    _S_utf8_carry | _S_utf8_too_large | _S_utf8_too_large_1000,
+};
+
+inline constexpr std::uint8_t _S_utf8_byte2_high[16] = {
+    _S_utf8_too_short, _S_utf8_too_short, _S_utf8_too_short, _S_utf8_too_short,
+    _S_utf8_too_short, _S_utf8_too_short, _S_utf8_too_short, _S_utf8_too_short,
+    _S_utf8_too_long | _S_utf8_overlong_2 | _S_utf8_two_conts | _S_utf8_overlong_3 | _S_utf8_too_large_1000 | _S_utf8_overlong_4,
+    _S_utf8_too_long | _S_utf8_overlong_2 | _S_utf8_two_conts | _S_utf8_overlong_3 | _S_utf8_too_large,
+    _S_utf8_too_long | _S_utf8_overlong_2 | _S_utf8_two_conts | _S_utf8_surrogate | _S_utf8_too_large,
+    _S_utf8_too_long | _S_utf8_overlong_2 | _S_utf8_two_conts | _S_utf8_surrogate | _S_utf8_too_large,
+    _S_utf8_too_short, _S_utf8_too_short, _S_utf8_too_short, _S_utf8_too_short,
+};
+
+// 块末尾 3 个字节若是多字节字符的首字节，说明字符被截断，需要下一块来补全
+inline constexpr std::uint8_t _S_utf8_incomplete_max[32] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    0xf0 - 1, 0xe0 - 1, 0xc0 - 1,
+};
+
+_LIBPENGCXX_TARGET_AVX2 inline __m256i _S_avx2_table(std::uint8_t const *__t) noexcept {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(__t)));
+}
+
+template <int _Np> // 当前块整体右移 _Np 字节，空出的位置由上一块末尾的字节填上
+_LIBPENGCXX_TARGET_AVX2 inline __m256i _S_avx2_prev(__m256i __input, __m256i __prev) noexcept {
+    return _mm256_alignr_epi8(__input, _mm256_permute2x128_si256(__prev, __input, 0x21), 16 - _Np);
+}
+
+// 处理一块 32 字节，错误标志累积到 __error，__prev_input 与 __prev_incomplete 记录上一块的状态
+_LIBPENGCXX_TARGET_AVX2 inline void _S_utf8_avx2_step(__m256i __input, __m256i &__error, __m256i &__prev_input,
+                                                      __m256i &__prev_incomplete) noexcept {
+    if (_mm256_movemask_epi8(__input) == 0) { // 整块都是 ASCII，只需确认上一块没有截断
+        __error = _mm256_or_si256(__error, __prev_incomplete);
+        return;
+    }
+    __m256i const __nibble = _mm256_set1_epi8(0x0f);
+    __m256i __prev1 = _S_avx2_prev<1>(__input, __prev_input);
+    __m256i __b1h = _mm256_shuffle_epi8(_S_avx2_table(_S_utf8_byte1_high),
+                                        _mm256_and_si256(_mm256_srli_epi16(__prev1, 4), __nibble));
+    __m256i __b1l = _mm256_shuffle_epi8(_S_avx2_table(_S_utf8_byte1_low),
+                                        _mm256_and_si256(__prev1, __nibble));
+    __m256i __b2h = _mm256_shuffle_epi8(_S_avx2_table(_S_utf8_byte2_high),
+                                        _mm256_and_si256(_mm256_srli_epi16(__input, 4), __nibble));
+    __m256i __special = _mm256_and_si256(_mm256_and_si256(__b1h, __b1l), __b2h);
+    // 三字节、四字节字符的第 3、4 个字节必须是后续字节，上面的两字节组合查不到，单独检查
+    __m256i __prev2 = _S_avx2_prev<2>(__input, __prev_input);
+    __m256i __prev3 = _S_avx2_prev<3>(__input, __prev_input);
+    __m256i __third = _mm256_subs_epu8(__prev2, _mm256_set1_epi8(char(0xe0 - 0x80)));
+    __m256i __fourth = _mm256_subs_epu8(__prev3, _mm256_set1_epi8(char(0xf0 - 0x80)));
+    __m256i __must23 = _mm256_and_si256(_mm256_or_si256(__third, __fourth), _mm256_set1_epi8(char(0x80)));
+    __error = _mm256_or_si256(__error, _mm256_xor_si256(__must23, __special));
+    __prev_incomplete = _mm256_subs_epu8(
+        __input, _mm256_loadu_si256(reinterpret_cast<__m256i const *>(_S_utf8_incomplete_max)));
+    __prev_input = __input;
+}
+
+_LIBPENGCXX_TARGET_AVX2 inline bool _S_utf8_validate_avx2(char const *__s, std::size_t __n) noexcept {
+    __m256i __error = _mm256_setzero_si256();
+    __m256i __prev_input = _mm256_setzero_si256();
+    __m256i __prev_incomplete = _mm256_setzero_si256();
+    std::size_t __i = 0;
+    for (; __i + 32 <= __n; __i += 32)
+        _S_utf8_avx2_step(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(__s + __i)),
+                          __error, __prev_input, __prev_incomplete);
+    if (__i < __n) { // 剩余不足 32 字节，补 0（即 ASCII）后再处理一次
+        char __buf[32] = {};
+        std::memcpy(__buf, __s + __i, __n - __i);
+        _S_utf8_avx2_step(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(__buf)),
+                          __error, __prev_input, __prev_incomplete);
+    }
+    __error = _mm256_or_si256(__error, __prev_incomplete);
+    return _mm256_testz_si256(__error, __error);
+}
+#endif
+
+using _Utf8ValidateFunction = bool (*)(char const *, std::size_t) noexcept;
+
+inline _Utf8ValidateFunction _S_utf8_validate_dispatch() noexcept {
+    static _Utf8ValidateFunction const __function = [] () -> _Utf8ValidateFunction {
+#if _LIBPENGCXX_UTF8_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return _S_utf8_validate_avx2;
+#endif
+        return _S_utf8_validate_scalar;
+    }();
+    return __function;
+}
+
+inline bool validateUtf8(std::string_view __sv) noexcept {
+    return _S_utf8_validate_dispatch()(__sv.data(), __sv.size());
+}
+
+// 从 __p 开始把连续的 ASCII 字节扩展为 UTF-16 / UTF-32 单元写入 __d，遇到含非 ASCII 字节的块即停下，返回处理的字节数
+// 有 SSE2 时每次 16 字节，与 0 交错即完成扩展；否则每次 8 字节，从寄存器中移位取出
+template <class _CharT>
+inline std::size_t _S_widen_ascii(_CharT *__d, unsigned char const *__p, std::size_t __n) noexcept {
+    std::size_t __i = 0;
+#ifdef __SSE2__
+    __m128i const __zero = _mm_setzero_si128();
+    for (; __i + 16 <= __n; __i += 16) {
+        __m128i __v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(__p + __i));
+        if (_mm_movemask_epi8(__v) != 0)
+            break;
+        __m128i __lo = _mm_unpacklo_epi8(__v, __zero);
+        __m128i __hi = _mm_unpackhi_epi8(__v, __zero);
+        auto *__out = reinterpret_cast<__m128i *>(__d + __i);
+        if constexpr (sizeof(_CharT) == 2) {
+            _mm_storeu_si128(__out, __lo);
+            _mm_storeu_si128(__out + 1, __hi);
+        } else {
+            _mm_storeu_si128(__out, _mm_unpacklo_epi16(__lo, __zero));
+            _mm_storeu_si128(__out + 1, _mm_unpackhi_epi16(__lo, __zero));
+            _mm_storeu_si128(__out + 2, _mm_unpacklo_epi16(__hi, __zero));
+            _mm_storeu_si128(__out + 3, _mm_unpackhi_epi16(__hi, __zero));
+        }
+    }
+#endif
+    for (; __i + 8 <= __n; __i += 8) {
+        std::uint64_t __w = _S_load8(__p + __i);
+        if (__w & 0x8080808080808080ull)
+            break;
+        for (std::size_t __k = 0; __k < 8; ++__k)
+            __d[__i + __k] = static_cast<_CharT>((__w >> (__k * 8)) & 0xff);
+    }
+    return __i;
+}
+
+// 统计字符数与四字节字符数，输入已经校验过
+// 每次处理 8 字节：后续字节是 10______，四字节首字节是 11110___，都用位运算在整个字里一起判断
+// 每个字节的判断结果移到最低位后乘以 0x0101...01，最高字节即为 8 个字节之和（不用 popcount，默认的 x86-64 目标没有这条指令）
+inline void _S_utf8_count(unsigned char const *__p, std::size_t __n, std::size_t &__chars, std::size_t &__quads) noexcept {
+    std::size_t __cont = 0, __i = 0;
+    __quads = 0;
+#ifdef __SSE2__
+    // 比较结果为 0 或 0xff，与 1 相与后用 psadbw 把 16 个字节加成两个 64 位和
+    __m128i const __zero = _mm_setzero_si128();
+    __m128i const __one = _mm_set1_epi8(1);
+    __m128i __cont_acc = __zero, __quad_acc = __zero;
+    for (; __i + 16 <= __n; __i += 16) {
+        __m128i __v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(__p + __i));
+        __m128i __is_cont = _mm_cmplt_epi8(__v, _mm_set1_epi8(-0x40)); // 有符号比较：0x80~0xbf 即 -128~-65
+        __m128i __is_quad = _mm_cmpeq_epi8(_mm_max_epu8(__v, _mm_set1_epi8(char(0xf0))), __v);
+        __cont_acc = _mm_add_epi64(__cont_acc, _mm_sad_epu8(_mm_and_si128(__is_cont, __one), __zero));
+        __quad_acc = _mm_add_epi64(__quad_acc, _mm_sad_epu8(_mm_and_si128(__is_quad, __one), __zero));
+    }
+    std::uint64_t __sums[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(__sums), __cont_acc);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(__sums + 2), __quad_acc);
+    __cont += static_cast<std::size_t>(__sums[0] + __sums[1]);
+    __quads += static_cast<std::size_t>(__sums[2] + __sums[3]);
+#endif
+    for (; __i + 8 <= __n; __i += 8) {
+        std::uint64_t __w = _S_load8(__p + __i);
+        std::uint64_t const __high = 0x8080808080808080ull;
+        std::uint64_t const __ones = 0x0101010101010101ull;
+        __cont += static_cast<std::size_t>((((__w & ~(__w << 1) & __high) >> 7) * __ones) >> 56);
+        __quads += static_cast<std::size_t>((((__w & (__w << 1) & (__w << 2) & (__w << 3) & __high) >> 7) * __ones) >> 56);
+    }
+    for (; __i < __n; ++__i) {
+        __cont += (__p[__i] & 0xc0) == 0x80;
+        __quads += __p[__i] >= 0xf0;
+    }
+    __chars = __n - __cont;
+}
+
+// 解码一个字符，调用者保证输入合法，返回该字符占用的字节数
+inline std::size_t _S_utf8_decode(unsigned char const *__p, std::uint32_t &__cp) noexcept {
+    unsigned __c = __p[0];
+    if (__c < 0x80) {
+        __cp = __c;
+        return 1;
+    }
+    if (__c < 0xe0) {
+        __cp = ((__c & 0x1f) << 6) | (__p[1] & 0x3f);
+        return 2;
+    }
+    if (__c < 0xf0) {
+        __cp = ((__c & 0x0f) << 12) | ((__p[1] & 0x3f) << 6) | (__p[2] & 0x3f);
+        return 3;
+    }
+    __cp = ((__c & 0x07) << 18) | ((__p[1] & 0x3f) << 12) | ((__p[2] & 0x3f) << 6) | (__p[3] & 0x3f);
+    return 4;
+}
+
+// 把 __cp 编码为 UTF-8 写到 __out，返回写入的字节数
+inline std::size_t _S_utf8_encode(char *__out, std::uint32_t __cp) noexcept {
+    if (__cp < 0x80) {
+        __out[0] = static_cast<char>(__cp);
+        return 1;
+    }
+    if (__cp < 0x800) {
+        __out[0] = static_cast<char>(0xc0 | (__cp >> 6));
+        __out[1] = static_cast<char>(0x80 | (__cp & 0x3f));
+        return 2;
+    }
+    if (__cp < 0x10000) {
+        __out[0] = static_cast<char>(0xe0 | (__cp >> 12));
+        __out[1] = static_cast<char>(0x80 | ((__cp >> 6) & 0x3f));
+        __out[2] = static_cast<char>(0x80 | (__cp & 0x3f));
+        return 3;
+    }
+    __out[0] = static_cast<char>(0xf0 | (__cp >> 18));
+    __out[1] = static_cast<char>(0x80 | ((__cp >> 12) & 0x3f));
+    __out[2] = static_cast<char>(0x80 | ((__cp >> 6) & 0x3f));
+    __out[3] = static_cast<char>(0x80 | (__cp & 0x3f));
+    return 4;
+}
+
+inline std::size_t _S_utf8_encoded_size(std::uint32_t __cp) noexcept {
+    return __cp < 0x80 ? 1 : __cp < 0x800 ? 2 : __cp < 0x10000 ? 3 : 4;
+}
+
+inline Optional<Vector<char32_t>> utf8ToUtf32(std::string_view __sv) {
+    if (!validateUtf8(__sv))
+        return nullopt;
+    if (__sv.empty())
+        return Vector<char32_t>();
+    auto const *__p = reinterpret_cast<unsigned char const *>(__sv.data());
+    std::size_t const __n = __sv.size();
+    std::size_t __chars, __quads;
+    _S_utf8_count(__p, __n, __chars, __quads);
+    Vector<char32_t> __out(__chars);
+    char32_t *__d = __out.data();
+    std::size_t __i = 0;
+    while (__i < __n) {
+        std::size_t __k = _S_widen_ascii(__d, __p + __i, __n - __i);
+        __d += __k;
+        __i += __k;
+        if (__i == __n)
+            break;
+        std::uint32_t __cp;
+        __i += _S_utf8_decode(__p + __i, __cp);
+        *__d++ = __cp;
+    }
+    return __out;
+}
+
+inline Optional<Vector<char16_t>> utf8ToUtf16(std::string_view __sv) {
+    if (!validateUtf8(__sv))
+        return nullopt;
+    if (__sv.empty())
+        return Vector<char16_t>();
+    auto const *__p = reinterpret_cast<unsigned char const *>(__sv.data());
+    std::size_t const __n = __sv.size();
+    std::size_t __chars, __quads;
+    _S_utf8_count(__p, __n, __chars, __quads);
+    Vector<char16_t> __out(__chars + __quads); // 四字节字符在 UTF-16 中需要两个代理项
+    char16_t *__d = __out.data();
+    std::size_t __i = 0;
+    while (__i < __n) {
+        std::size_t __k = _S_widen_ascii(__d, __p + __i, __n - __i);
+        __d += __k;
+        __i += __k;
+        if (__i == __n)
+            break;
+        std::uint32_t __cp;
+        __i += _S_utf8_decode(__p + __i, __cp);
+        if (__cp >= 0x10000) {
+            __cp -= 0x10000;
+            *__d++ = static_cast<char16_t>(0xd800 + (__cp >> 10));
+            *__d++ = static_cast<char16_t>(0xdc00 + (__cp & 0x3ff));
+        } else {
+            *__d++ = static_cast<char16_t>(__cp);
+        }
+    }
+    return __out;
+}
+
+// 出现不成对的代理项时返回 nullopt
+inline Optional<String> utf16ToUtf8(std::u16string_view __sv) {
+    std::size_t const __n = __sv.size();
+    std::size_t __len = 0;
+    for (std::size_t __i = 0; __i < __n; ++__i) {
+        std::uint32_t __u = __sv[__i];
+        if (__u >= 0xd800 && __u <= 0xdfff) {
+            if (__u >= 0xdc00 || __i + 1 == __n || __sv[__i + 1] < 0xdc00 || __sv[__i + 1] > 0xdfff)
+                return nullopt;
+            ++__i;
+            __len += 4;
+        } else {
+            __len += _S_utf8_encoded_size(__u);
+        }
+    }
+    String __out;
+    __out.resize_and_overwrite(__len, [&] (char *__d, std::size_t) noexcept {
+        char *__q = __d;
+        for (std::size_t __i = 0; __i < __n; ++__i) {
+            std::uint32_t __u = __sv[__i];
+            if (__u >= 0xd800 && __u <= 0xdfff) {
+                __u = 0x10000 + ((__u - 0xd800) << 10) + (__sv[++__i] - 0xdc00);
+            }
+            __q += _S_utf8_encode(__q, __u);
+        }
+        return __q - __d;
+    });
+    return __out;
+}
+
+// 出现代理区或超出 0x10ffff 的码点时返回 nullopt
+inline Optional<String> utf32ToUtf8(std::u32string_view __sv) {
+    std::size_t __len = 0;
+    for (char32_t __c : __sv) {
+        if (__c > 0x10ffff || (__c >= 0xd800 && __c <= 0xdfff))
+            return nullopt;
+        __len += _S_utf8_encoded_size(__c);
+    }
+    String __out;
+    __out.resize_and_overwrite(__len, [&] (char *__d, std::size_t) noexcept {
+        char *__q = __d;
+        for (char32_t __c : __sv)
+            __q += _S_utf8_encode(__q, __c);
+        return __q - __d;
+    });
+    return __out;
+}
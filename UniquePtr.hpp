@@ -1,136 +1,283 @@
 #pragma once
 
+#include <cstddef>
 #include <type_traits>
 #include <utility>
 
 template <class _Tp>
 struct DefaultDeleter { // 默认使用 delete 释放内存
+    DefaultDeleter() noexcept = default;
+
+    // 允许 UniquePtr<Derived> 转换为 UniquePtr<Base> 时一并转换删除器
+    template <class _Up, std::enable_if_t<std::is_convertible_v<_Up *, _Tp *>, int> = 0>
+    DefaultDeleter(DefaultDeleter<_Up> const &) noexcept {}
+
     void operator()(_Tp *p) const {
+        static_assert(sizeof(_Tp) > 0, "不能 delete 不完整类型");
         delete p;
     }
 };
 
+// delete[] 由编译器负责尺寸与对齐：有数组 cookie 的类型调用带尺寸的 operator delete[]，
+// 超对齐类型调用带 std::align_val_t 的版本，删除器本身不需要记录长度，保持为空类型
 template <class _Tp>
 struct DefaultDeleter<_Tp[]> { // 偏特化
-    void operator()(_Tp *p) const {
+    DefaultDeleter() noexcept = default;
+
+    // 数组只允许添加 const/volatile 的转换，Derived[] 不能当作 Base[] 删除
+    template <class _Up, std::enable_if_t<std::is_convertible_v<_Up (*)[], _Tp (*)[]>, int> = 0>
+    DefaultDeleter(DefaultDeleter<_Up[]> const &) noexcept {}
+
+    template <class _Up, std::enable_if_t<std::is_convertible_v<_Up (*)[], _Tp (*)[]>, int> = 0>
+    void operator()(_Up *p) const {
+        static_assert(sizeof(_Tp) > 0, "不能 delete 不完整类型");
         delete[] p;
     }
 };
 
-template <class _Tp, class _Deleter = DefaultDeleter<_Tp>>
-struct UniquePtr {
-private:
-    _Tp *_M_p;
-    [[no_unique_address]] _Deleter _M_deleter;
+// 删除器定义了 pointer 类型时，UniquePtr 保存的就是这种指针，例如指向共享内存或 mmap 区域的偏移指针
+template <class _Tp, class _Deleter, class = void>
+struct _UniquePtrPointer {
+    using type = _Tp *;
+};
 
-    template <class _Up, class _UDeleter>
-    friend struct UniquePtr;
+template <class _Tp, class _Deleter>
+struct _UniquePtrPointer<_Tp, _Deleter, std::void_t<typename std::remove_reference_t<_Deleter>::pointer>> {
+    using type = typename std::remove_reference_t<_Deleter>::pointer;
+};
 
-public:
-    using element_type = _Tp;
-    using pointer = _Tp *;
+// 单个对象与数组共用的部分：保存指针与删除器，负责移动、交换、释放
+// 空删除器借助 [[no_unique_address]] 不占空间，UniquePtr 与裸指针一样大
+template <class _Tp, class _Deleter>
+struct _UniquePtrBase {
+    using pointer = typename _UniquePtrPointer<std::remove_extent_t<_Tp>, _Deleter>::type;
     using deleter_type = _Deleter;
 
-    UniquePtr(std::nullptr_t = nullptr) noexcept : _M_p(nullptr) { // 默认构造函数
-    }
+protected:
+    pointer _M_p;
+    [[no_unique_address]] _Deleter _M_deleter;
 
-    explicit UniquePtr(_Tp *p) noexcept : _M_p(p) { // 自定义构造函数
-    }
+    _UniquePtrBase() noexcept : _M_p(nullptr), _M_deleter() {}
 
-    template <class _Up, class _UDeleter, class = std::enable_if_t<std::is_convertible_v<_Up *, _Tp *>>> // 没有 C++20 的写法
-    // template <class _Up, class _UDeleter> requires (std::convertible_to<_Up *, _Tp *>) // 有 C++20 的写法
-    UniquePtr(UniquePtr<_Up, _UDeleter> &&__that) noexcept : _M_p(__that._M_p) {  // 从子类型_Up的智能指针转换到_Tp类型的智能指针
-        __that._M_p = nullptr;
-    }
+    explicit _UniquePtrBase(pointer __p) noexcept : _M_p(__p), _M_deleter() {}
 
-    ~UniquePtr() noexcept { // 析构函数
+    template <class _UDeleter>
+    _UniquePtrBase(pointer __p, _UDeleter &&__deleter) noexcept
+        : _M_p(__p), _M_deleter(std::forward<_UDeleter>(__deleter)) {}
+
+public:
+    ~_UniquePtrBase() noexcept { // 析构函数
         if (_M_p)
             _M_deleter(_M_p);
     }
 
-    UniquePtr(UniquePtr const &__that) = delete; // 拷贝构造函数
-    UniquePtr &operator=(UniquePtr const &__that) = delete; // 拷贝赋值函数
-    
-    UniquePtr(UniquePtr &&__that) noexcept : _M_p(__that._M_p) { // 移动构造函数
-        __that._M_p = nullptr;
-    }
-    
-    UniquePtr &operator=(UniquePtr &&__that) noexcept { // 移动赋值函数
+    _UniquePtrBase(_UniquePtrBase const &__that) = delete; // 拷贝构造函数
+    _UniquePtrBase &operator=(_UniquePtrBase const &__that) = delete; // 拷贝赋值函数
+
+    _UniquePtrBase(_UniquePtrBase &&__that) noexcept // 移动构造函数，删除器随指针一起移动
+        : _M_p(std::exchange(__that._M_p, nullptr)), _M_deleter(std::forward<_Deleter>(__that._M_deleter)) {}
+
+    _UniquePtrBase &operator=(_UniquePtrBase &&__that) noexcept { // 移动赋值函数
         if (this != &__that) [[likely]] {
-            if (_M_p)
-                _M_deleter(_M_p);
-            _M_p = std::exchange(__that._M_p, nullptr);
+            reset(__that.release());
+            _M_deleter = std::forward<_Deleter>(__that._M_deleter);
         }
         return *this;
     }
 
-    void swap(UniquePtr &__that) noexcept { // 交换函数
-        std::swap(_M_p, __that._M_p);
-    }
-
-    _Tp *get() const noexcept {
-        return _M_p;
+    void swap(_UniquePtrBase &__that) noexcept { // 交换函数
+        using std::swap;
+        swap(_M_p, __that._M_p);
+        swap(_M_deleter, __that._M_deleter);
     }
 
-    _Tp *operator->() const noexcept {
+    pointer get() const noexcept {
         return _M_p;
     }
 
-    std::add_lvalue_reference_t<_Tp> operator*() const noexcept {
-        return *_M_p;
+    _Deleter &get_deleter() noexcept {
+        return _M_deleter;
     }
 
-    _Deleter get_deleter() const noexcept {
+    _Deleter const &get_deleter() const noexcept {
         return _M_deleter;
     }
 
-    _Tp *release() noexcept {
-        _Tp *__p = _M_p;
-        _M_p = nullptr;
-        return __p;
+    pointer release() noexcept {
+        return std::exchange(_M_p, nullptr);
     }
 
-    void reset(_Tp *__p = nullptr) noexcept {
-        if (_M_p)
-            _M_deleter(_M_p);
-        _M_p = __p;
+    // 先换上新指针再删除旧对象，旧对象的析构函数再访问这个 UniquePtr 时看到的已经是新值
+    void reset(pointer __p = nullptr) noexcept {
+        pointer __old = std::exchange(_M_p, __p);
+        if (__old)
+            _M_deleter(__old);
     }
 
     explicit operator bool() const noexcept {
         return _M_p != nullptr;
     }
 
-    bool operator==(UniquePtr const &__that) const noexcept {
+    bool operator==(_UniquePtrBase const &__that) const noexcept {
         return _M_p == __that._M_p;
     }
 
-    bool operator!=(UniquePtr const &__that) const noexcept {
+    bool operator!=(_UniquePtrBase const &__that) const noexcept {
         return _M_p != __that._M_p;
     }
 
-    bool operator<(UniquePtr const &__that) const noexcept {
+    bool operator<(_UniquePtrBase const &__that) const noexcept {
         return _M_p < __that._M_p;
     }
 
-    bool operator<=(UniquePtr const &__that) const noexcept {
+    bool operator<=(_UniquePtrBase const &__that) const noexcept {
         return _M_p <= __that._M_p;
     }
 
-    bool operator>(UniquePtr const &__that) const noexcept {
+    bool operator>(_UniquePtrBase const &__that) const noexcept {
         return _M_p > __that._M_p;
     }
 
-    bool operator>=(UniquePtr const &__that) const noexcept {
+    bool operator>=(_UniquePtrBase const &__that) const noexcept {
         return _M_p >= __that._M_p;
     }
+
+    // 与 nullptr 比较：比较运算符放在基类里后不再能经由 UniquePtr(nullptr_t) 隐式转换
+    friend bool operator==(_UniquePtrBase const &__p, std::nullptr_t) noexcept {
+        return !__p;
+    }
+
+    friend bool operator==(std::nullptr_t, _UniquePtrBase const &__p) noexcept {
+        return !__p;
+    }
+
+    friend bool operator!=(_UniquePtrBase const &__p, std::nullptr_t) noexcept {
+        return static_cast<bool>(__p);
+    }
+
+    friend bool operator!=(std::nullptr_t, _UniquePtrBase const &__p) noexcept {
+        return static_cast<bool>(__p);
+    }
+};
+
+template <class _Tp, class _Deleter = DefaultDeleter<_Tp>>
+struct UniquePtr : _UniquePtrBase<_Tp, _Deleter> {
+private:
+    using _Base = _UniquePtrBase<_Tp, _Deleter>;
+
+    template <class _Up, class _UDeleter>
+    friend struct UniquePtr;
+
+public:
+    using element_type = _Tp;
+    using typename _Base::pointer;
+    using typename _Base::deleter_type;
+
+    UniquePtr(std::nullptr_t = nullptr) noexcept { // 默认构造函数
+    }
+
+    explicit UniquePtr(pointer p) noexcept : _Base(p) { // 自定义构造函数
+    }
+
+    // 带状态的删除器，例如记录所属内存池的删除器
+    UniquePtr(pointer p, _Deleter const &__deleter) noexcept : _Base(p, __deleter) {}
+
+    template <class _D = _Deleter, std::enable_if_t<!std::is_reference_v<_D>, int> = 0>
+    UniquePtr(pointer p, _Deleter &&__deleter) noexcept : _Base(p, std::move(__deleter)) {}
+
+    UniquePtr(UniquePtr &&__that) noexcept = default; // 移动构造函数
+    UniquePtr &operator=(UniquePtr &&__that) noexcept = default; // 移动赋值函数
+
+    template <class _Up, class _UDeleter, class = std::enable_if_t<
+        !std::is_array_v<_Up> &&
+        std::is_convertible_v<typename UniquePtr<_Up, _UDeleter>::pointer, pointer> &&
+        std::is_convertible_v<_UDeleter, _Deleter>>> // 没有 C++20 的写法
+    // template <class _Up, class _UDeleter> requires (std::convertible_to<_Up *, _Tp *>) // 有 C++20 的写法
+    UniquePtr(UniquePtr<_Up, _UDeleter> &&__that) noexcept // 从子类型_Up的智能指针转换到_Tp类型的智能指针，删除器一并转移
+        : _Base(__that.release(), std::forward<_UDeleter>(__that._M_deleter)) {}
+
+    template <class _Up, class _UDeleter, class = std::enable_if_t<
+        !std::is_array_v<_Up> &&
+        std::is_convertible_v<typename UniquePtr<_Up, _UDeleter>::pointer, pointer> &&
+        std::is_assignable_v<_Deleter &, _UDeleter &&>>>
+    UniquePtr &operator=(UniquePtr<_Up, _UDeleter> &&__that) noexcept {
+        this->reset(__that.release());
+        this->_M_deleter = std::forward<_UDeleter>(__that._M_deleter);
+        return *this;
+    }
+
+    void swap(UniquePtr &__that) noexcept {
+        _Base::swap(__that);
+    }
+
+    pointer operator->() const noexcept {
+        return this->_M_p;
+    }
+
+    std::add_lvalue_reference_t<_Tp> operator*() const noexcept {
+        return *this->_M_p;
+    }
 };
 
+// 数组版本不再继承单个对象的版本：没有 operator-> 与 operator*，也不允许 Derived[] 转换为 Base[]
 template <class _Tp, class _Deleter>
-struct UniquePtr<_Tp[], _Deleter> : UniquePtr<_Tp, _Deleter> {
-    using UniquePtr<_Tp, _Deleter>::UniquePtr;
+struct UniquePtr<_Tp[], _Deleter> : _UniquePtrBase<_Tp[], _Deleter> {
+private:
+    using _Base = _UniquePtrBase<_Tp[], _Deleter>;
+
+    template <class _Up, class _UDeleter>
+    friend struct UniquePtr;
+
+    // 只接受与 pointer 相同的类型，或者仅多了 const/volatile 的元素指针
+    template <class _Up>
+    static constexpr bool _S_compatible = std::is_same_v<_Up, typename _Base::pointer> ||
+        (std::is_same_v<typename _Base::pointer, _Tp *> && std::is_pointer_v<_Up> &&
+         std::is_convertible_v<std::remove_pointer_t<_Up> (*)[], _Tp (*)[]>);
+
+public:
+    using element_type = _Tp;
+    using typename _Base::pointer;
+    using typename _Base::deleter_type;
+
+    UniquePtr(std::nullptr_t = nullptr) noexcept {}
+
+    template <class _Up, std::enable_if_t<_S_compatible<_Up>, int> = 0>
+    explicit UniquePtr(_Up p) noexcept : _Base(p) {}
+
+    template <class _Up, std::enable_if_t<_S_compatible<_Up>, int> = 0>
+    UniquePtr(_Up p, _Deleter const &__deleter) noexcept : _Base(p, __deleter) {}
+
+    template <class _Up, class _D = _Deleter,
+              std::enable_if_t<_S_compatible<_Up> && !std::is_reference_v<_D>, int> = 0>
+    UniquePtr(_Up p, _Deleter &&__deleter) noexcept : _Base(p, std::move(__deleter)) {}
+
+    UniquePtr(UniquePtr &&__that) noexcept = default;
+    UniquePtr &operator=(UniquePtr &&__that) noexcept = default;
+
+    // UniquePtr<int[]> 可以转换为 UniquePtr<int const[]>
+    template <class _Up, class _UDeleter, class = std::enable_if_t<
+        std::is_same_v<typename UniquePtr<_Up[], _UDeleter>::pointer, _Up *> &&
+        std::is_same_v<pointer, _Tp *> &&
+        std::is_convertible_v<_Up (*)[], _Tp (*)[]> &&
+        std::is_convertible_v<_UDeleter, _Deleter>>>
+    UniquePtr(UniquePtr<_Up[], _UDeleter> &&__that) noexcept
+        : _Base(__that.release(), std::forward<_UDeleter>(__that._M_deleter)) {}
+
+    template <class _Up, std::enable_if_t<_S_compatible<_Up>, int> = 0>
+    void reset(_Up __p) noexcept {
+        _Base::reset(__p);
+    }
+
+    void reset(std::nullptr_t = nullptr) noexcept {
+        _Base::reset();
+    }
+
+    void swap(UniquePtr &__that) noexcept {
+        _Base::swap(__that);
+    }
 
-    std::add_lvalue_reference_t<_Tp> operator[](std::size_t __i) {
-        return this->get()[__i];
+    std::add_lvalue_reference_t<_Tp> operator[](std::size_t __i) const {
+        return this->_M_p[__i];
     }
 };
 
@@ -144,6 +291,7 @@ UniquePtr<_Tp> makeUniqueForOverwrite() {
     return UniquePtr<_Tp>(new _Tp);
 }
 
+// new[] 与 DefaultDeleter<T[]> 的 delete[] 配对，超对齐的元素类型同样按其对齐分配与释放
 template <class _Tp, std::enable_if_t<std::is_unbounded_array_v<_Tp>, int> = 0>
 UniquePtr<_Tp> makeUnique(std::size_t __len) {
     return UniquePtr<_Tp>(new std::remove_extent_t<_Tp>[__len]());
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
 #include <type_traits>
 #include <functional>
+#include <tuple>
+#include <utility>
+#include "_Common.hpp"
 
 // 今天来实现标准库中的 variant 和 visit
 
@@ -34,146 +38,289 @@ struct VariantAlternative;
 // VariantIndex<Variant<int, double>, int> = 1;
 // VariantIndex<Variant<int, double>, double> = 2;
 
+template <typename>
+struct VariantSize;
+
+struct VariantAccess;
+
+// 递归的 union 代替 char 数组存放各个可选类型，这样无需 reinterpret_cast，构造、访问都可以在编译期进行
 template <typename ...Ts>
-struct Variant {
-private:
-    size_t m_index;
+union VariantUnion {
+};
 
-    alignas(std::max({alignof(Ts)...})) char m_union[std::max({sizeof(Ts)...})];
+template <typename T, typename ...Ts>
+union VariantUnion<T, Ts...> {
+    T m_head;
+    VariantUnion<Ts...> m_tail;
 
-    using DestructorFunction = void(*)(char *) noexcept;
+    constexpr VariantUnion() noexcept {} // 不激活任何成员，由 Variant 随后构造
 
-    static DestructorFunction *destructors_table() noexcept {
-        static DestructorFunction function_ptrs[sizeof...(Ts)] = {
-            [] (char *union_p) noexcept {
-                reinterpret_cast<Ts *>(union_p)->~Ts();
-            }...
-        };
-        return function_ptrs;
-    }
+    template <typename ...Args>
+    constexpr explicit VariantUnion(InPlaceIndex<0>, Args &&...value_args)
+        : m_head(std::forward<Args>(value_args)...) {}
 
-    using CopyConstructorFunction = void(*)(char *, char const *) noexcept;
+    template <size_t I, typename ...Args>
+    constexpr explicit VariantUnion(InPlaceIndex<I>, Args &&...value_args)
+        : m_tail(inPlaceIndex<I - 1>, std::forward<Args>(value_args)...) {}
+
+    // 所有可选类型都可平凡析构时 union 也应平凡析构，否则由 Variant 负责析构当前激活的成员
+    ~VariantUnion() requires (std::is_trivially_destructible_v<T> && ... && std::is_trivially_destructible_v<Ts>) = default;
+
+    constexpr ~VariantUnion() noexcept {}
+};
 
-    static CopyConstructorFunction *copy_constructors_table() noexcept {
-        static CopyConstructorFunction function_ptrs[sizeof...(Ts)] = {
-            [] (char *union_dst, char const *union_src) noexcept {
-                new (union_dst) Ts(*reinterpret_cast<Ts const *>(union_src));
-            }...
-        };
-        return function_ptrs;
+// 取出 union 中第 I 个成员，U 带 const 时返回 const 引用
+template <size_t I, typename U>
+constexpr auto &variant_union_get(U &u) noexcept {
+    if constexpr (I == 0)
+        return u.m_head;
+    else
+        return variant_union_get<I - 1>(u.m_tail);
+}
+
+// 根据运行时的 i 调用 f(std::integral_constant<size_t, i>())，所有操作都通过它分派
+// 不超过 16 个可选类型时生成 switch，编译器可以内联每个分支；更多时查编译期生成的函数指针表
+template <typename R, typename F, typename Seq>
+struct VariantDispatchTable;
+
+template <typename R, typename F, size_t ...Is>
+struct VariantDispatchTable<R, F, std::index_sequence<Is...>> {
+    template <size_t I>
+    static constexpr R entry(F &&f) {
+        return std::forward<F>(f)(std::integral_constant<size_t, I>());
     }
 
-    using CopyAssignmentFunction = void(*)(char *, char const *) noexcept;
+    using Entry = R(*)(F &&);
+
+    static constexpr Entry table[] = {&entry<Is>...};
+};
 
-    static CopyAssignmentFunction *copy_assigment_functions_table() noexcept {
-        static CopyAssignmentFunction function_ptrs[sizeof...(Ts)] = {
-            [] (char *union_dst, char const *union_src) noexcept {
-                *reinterpret_cast<Ts *>(union_dst) = *reinterpret_cast<Ts const *>(union_src);
-            }...
-        };
-        return function_ptrs;
+#define _LIBPENGCXX_VARIANT_CASE(k) \
+    case k: \
+        if constexpr (k < N) \
+            return std::forward<F>(f)(std::integral_constant<size_t, k>()); \
+        else \
+            _LIBPENGCXX_UNREACHABLE();
+
+template <size_t N, typename R, typename F>
+constexpr R variant_visit_index(size_t i, F &&f) {
+    if constexpr (N <= 16) {
+        switch (i) {
+            _LIBPENGCXX_VARIANT_CASE(0) _LIBPENGCXX_VARIANT_CASE(1) _LIBPENGCXX_VARIANT_CASE(2) _LIBPENGCXX_VARIANT_CASE(3)
+            _LIBPENGCXX_VARIANT_CASE(4) _LIBPENGCXX_VARIANT_CASE(5) _LIBPENGCXX_VARIANT_CASE(6) _LIBPENGCXX_VARIANT_CASE(7)
+            _LIBPENGCXX_VARIANT_CASE(8) _LIBPENGCXX_VARIANT_CASE(9) _LIBPENGCXX_VARIANT_CASE(10) _LIBPENGCXX_VARIANT_CASE(11)
+            _LIBPENGCXX_VARIANT_CASE(12) _LIBPENGCXX_VARIANT_CASE(13) _LIBPENGCXX_VARIANT_CASE(14) _LIBPENGCXX_VARIANT_CASE(15)
+        }
+        _LIBPENGCXX_UNREACHABLE();
+    } else {
+        return VariantDispatchTable<R, F, std::make_index_sequence<N>>::table[i](std::forward<F>(f));
     }
+}
+
+#undef _LIBPENGCXX_VARIANT_CASE
 
-    using MoveConstructorFunction = void(*)(char *, char *) noexcept;
+// index 取能容纳 sizeof...(Ts) 个取值的最小无符号整数，Variant<int, float> 因此只需 8 字节
+template <size_t N>
+using VariantIndexType = std::conditional_t<(N <= 0xff), unsigned char,
+                         std::conditional_t<(N <= 0xffff), unsigned short, unsigned int>>;
 
-    static MoveConstructorFunction *move_constructors_table() noexcept {
-        static MoveConstructorFunction function_ptrs[sizeof...(Ts)] = {
-            [] (char *union_dst, char *union_src) noexcept {
-                new (union_dst) Ts(std::move(*reinterpret_cast<Ts const *>(union_src)));
-            }...
-        };
-        return function_ptrs;
+// 空闲取值布局：只有一个非空的可选类型，它通过 NicheTraits 声明了至少 N - 1 个空闲取值，其余都是平凡的空类型
+// 此时其余可选类型各占用一个空闲取值，index 由存储的位模式算出，不再单独存放，如 Variant<bool, Leaf> 只占 1 字节
+// 指针默认没有空闲取值，为 Node * 声明了 NichePointerTraits 后，Variant<Node *, Leaf, Eof> 才与指针一样大
+// 该布局下 index() 需要读取对象表示，无法在编译期求值
+template <typename ...Ts>
+struct VariantNiche {
+    static constexpr bool empties[] = {std::is_empty_v<Ts>...};
+
+    static constexpr size_t dataful = [] {
+        size_t i = 0;
+        while (i < sizeof...(Ts) && empties[i])
+            i++;
+        return i;
+    }();
+
+    static constexpr size_t count = (!std::is_empty_v<Ts> + ...);
+
+    template <size_t D = dataful>
+    static constexpr bool check() noexcept {
+        if constexpr (sizeof...(Ts) < 2 || count != 1) {
+            return false;
+        } else {
+            using T = std::remove_cv_t<std::tuple_element_t<D, std::tuple<Ts...>>>;
+            return NicheTraits<T>::count >= sizeof...(Ts) - 1
+                && ((!std::is_empty_v<Ts> || (std::is_trivially_copyable_v<Ts> && std::is_trivially_destructible_v<Ts>)) && ...);
+        }
     }
 
-    using MoveAssignmentFunction = void(*)(char *, char *) noexcept;
+    static constexpr bool value = check();
+};
+
+struct VariantNoIndex {
+    constexpr explicit VariantNoIndex(size_t) noexcept {}
+};
+
+template <typename ...Ts>
+struct Variant {
+private:
+    friend VariantAccess;
+
+    using Niche = VariantNiche<Ts...>;
+
+    [[no_unique_address]] std::conditional_t<Niche::value, VariantNoIndex, VariantIndexType<sizeof...(Ts)>> m_index;
+
+    VariantUnion<Ts...> m_union;
 
-    static MoveAssignmentFunction *move_assigment_functions_table() noexcept {
-        static MoveAssignmentFunction function_ptrs[sizeof...(Ts)] = {
-            [] (char *union_dst, char *union_src) noexcept {
-                *reinterpret_cast<Ts *>(union_dst) = std::move(*reinterpret_cast<Ts *>(union_src));
-            }...
-        };
-        return function_ptrs;
+    // 所有可选类型都满足相应的平凡性时，拷贝、移动与析构也是平凡的：直接按字节复制整个对象，析构什么都不做
+    // 这样 Variant 本身可平凡拷贝，Vector 扩容时可以 memcpy，按值传参时可以放在寄存器里
+    static constexpr bool trivial_copy = (std::is_trivially_copy_constructible_v<Ts> && ...);
+    static constexpr bool trivial_move = (std::is_trivially_move_constructible_v<Ts> && ...);
+    static constexpr bool trivial_destroy = (std::is_trivially_destructible_v<Ts> && ...);
+    static constexpr bool trivial_copy_assign = trivial_copy && trivial_destroy && (std::is_trivially_copy_assignable_v<Ts> && ...);
+    static constexpr bool trivial_move_assign = trivial_move && trivial_destroy && (std::is_trivially_move_assignable_v<Ts> && ...);
+
+    // 记录当前为第 I 个可选类型，空闲取值布局下要在构造好该可选类型之后调用
+    template <size_t I>
+    constexpr void set_index() noexcept {
+        if constexpr (Niche::value) {
+            if constexpr (I != Niche::dataful) {
+                using D = std::remove_cv_t<typename VariantAlternative<Variant, Niche::dataful>::type>;
+                NicheTraits<D>::_S_store(&m_union, I < Niche::dataful ? I : I - 1);
+            }
+        } else {
+            m_index = I;
+        }
     }
 
-    template <class Lambda>
-    using ConstVisitorFunction = std::common_type<typename std::invoke_result<Lambda, Ts const &>::type...>::type(*)(char const *, Lambda &&);
+    template <typename R, typename F>
+    constexpr R visit_index(F &&f) const {
+        return variant_visit_index<sizeof...(Ts), R>(index(), std::forward<F>(f));
+    }
 
-    template <class Lambda>
-    static ConstVisitorFunction<Lambda> *const_visitors_table() noexcept {
-        static ConstVisitorFunction<Lambda> function_ptrs[sizeof...(Ts)] = {
-            [] (char const *union_p, Lambda &&lambda) -> typename std::invoke_result<Lambda, Ts const &>::type {
-                std::invoke(std::forward<Lambda>(lambda),
-                            *reinterpret_cast<Ts const *>(union_p));
-            }...
-        };
-        return function_ptrs;
+    constexpr void destroy() noexcept {
+        visit_index<void>([this] (auto i) {
+            std::destroy_at(&variant_union_get<i>(m_union));
+        });
     }
 
-    template <class Lambda>
-    using VisitorFunction = std::common_type<typename std::invoke_result<Lambda, Ts &>::type...>::type(*)(char *, Lambda &&);
+    // 调用前当前值应已析构（或尚未构造）
+    template <size_t I, typename ...Args>
+    constexpr void construct(Args &&...value_args) {
+        std::construct_at(&m_union, inPlaceIndex<I>, std::forward<Args>(value_args)...);
+        set_index<I>();
+    }
 
-    template <class Lambda>
-    static VisitorFunction<Lambda> *visitors_table() noexcept {
-        static VisitorFunction<Lambda> function_ptrs[sizeof...(Ts)] = {
-            [] (char *union_p, Lambda &&lambda) -> std::common_type<typename std::invoke_result<Lambda, Ts &>::type...>::type {
-                return std::invoke(std::forward<Lambda>(lambda),
-                                   *reinterpret_cast<Ts *>(union_p));
-            }...
-        };
-        return function_ptrs;
+    // 把当前值换成第 I 个可选类型：没有“无值”状态，析构旧值之后的构造不能再抛出异常
+    // 从 src 构造可能抛出时先构造到临时对象里，失败则 *this 保持原样，再用不抛出异常的移动构造放进来
+    template <size_t I, typename Src>
+    constexpr void replace(Src &&src) {
+        using T = typename VariantAlternative<Variant, I>::type;
+        if constexpr (std::is_nothrow_constructible_v<T, Src &&>) {
+            destroy();
+            construct<I>(std::forward<Src>(src));
+        } else {
+            static_assert(std::is_nothrow_move_constructible_v<T>,
+                          "Variant 切换到另一个可选类型时，该类型的移动构造函数必须是 noexcept");
+            T tmp(std::forward<Src>(src));
+            destroy();
+            construct<I>(std::move(tmp));
+        }
     }
 
 public:
     template <typename T, typename std::enable_if<
         std::disjunction<std::is_same<T, Ts>...>::value,
         int>::type = 0>
-    Variant(T value) : m_index(VariantIndex<Variant, T>::value) {
-        T *p = reinterpret_cast<T *>(m_union);
-        new (p) T(value);
+    constexpr Variant(T value) : m_index(VariantIndex<Variant, T>::value)
+        , m_union(inPlaceIndex<VariantIndex<Variant, T>::value>, std::move(value)) {
+        set_index<VariantIndex<Variant, T>::value>();
     }
 
-    Variant(Variant const &that) : m_index(that.m_index) {
-        copy_constructors_table()[index()](m_union, that.m_union);
+    Variant(Variant const &that) requires trivial_copy = default;
+    Variant(Variant &&that) requires trivial_move = default;
+    Variant &operator=(Variant const &that) requires trivial_copy_assign = default;
+    Variant &operator=(Variant &&that) requires trivial_move_assign = default;
+    ~Variant() requires trivial_destroy = default;
+
+    constexpr Variant(Variant const &that) : m_index(that.m_index) {
+        that.visit_index<void>([&] (auto i) {
+            construct<i>(variant_union_get<i>(that.m_union));
+        });
     }
 
-    Variant &operator=(Variant const &that) {
-        m_index = that.m_index;
-        copy_assigment_functions_table()[index()](m_union, that.m_union);
+    constexpr Variant &operator=(Variant const &that) {
+        if (this == &that) [[unlikely]]
+            return *this;
+        if (index() == that.index()) {
+            visit_index<void>([&] (auto i) {
+                variant_union_get<i>(m_union) = variant_union_get<i>(that.m_union);
+            });
+        } else {
+            that.visit_index<void>([&] (auto i) {
+                replace<i>(variant_union_get<i>(that.m_union));
+            });
+        }
+        return *this;
     }
 
-    Variant(Variant &&that) : m_index(that.m_index) {
-        move_constructors_table()[index()](m_union, that.m_union);
+    constexpr Variant(Variant &&that) noexcept((std::is_nothrow_move_constructible_v<Ts> && ...)) : m_index(that.m_index) {
+        that.visit_index<void>([&] (auto i) {
+            construct<i>(std::move(variant_union_get<i>(that.m_union)));
+        });
     }
 
-    Variant &operator=(Variant &&that) {
-        m_index = that.m_index;
-        move_assigment_functions_table()[index()](m_union, that.m_union);
+    constexpr Variant &operator=(Variant &&that) noexcept((std::is_nothrow_move_constructible_v<Ts> && ...)
+                                                    && (std::is_nothrow_move_assignable_v<Ts> && ...)) {
+        if (this == &that) [[unlikely]]
+            return *this;
+        if (index() == that.index()) {
+            visit_index<void>([&] (auto i) {
+                variant_union_get<i>(m_union) = std::move(variant_union_get<i>(that.m_union));
+            });
+        } else {
+            that.visit_index<void>([&] (auto i) {
+                replace<i>(std::move(variant_union_get<i>(that.m_union)));
+            });
+        }
+        return *this;
     }
 
     template <size_t I, typename ...Args>
-    explicit Variant(InPlaceIndex<I>, Args &&...value_args) : m_index(I) {
-        new (m_union) typename VariantAlternative<Variant, I>::type
-            (std::forward<Args>(value_args)...);
+    constexpr explicit Variant(InPlaceIndex<I>, Args &&...value_args) : m_index(I)
+        , m_union(inPlaceIndex<I>, std::forward<Args>(value_args)...) {
+        set_index<I>();
     }
 
-    ~Variant() noexcept {
-        destructors_table()[index()](m_union);
+    constexpr ~Variant() noexcept {
+        destroy();
     }
 
     template <class Lambda>
-    std::common_type<typename std::invoke_result<Lambda, Ts &>::type...>::type visit(Lambda &&lambda) {
-        // 由于时间原因，暂时没有实现支持多参数的std::visit，决定留作回家作业，供学有余力的同学自己尝试实现
-        return visitors_table<Lambda>()[index()](m_union, std::forward<Lambda>(lambda));
+    constexpr std::common_type<typename std::invoke_result<Lambda, Ts &>::type...>::type visit(Lambda &&lambda) {
+        // 多个 Variant 同时访问请用下面的自由函数 visit(lambda, v1, v2, ...)
+        using R = std::common_type<typename std::invoke_result<Lambda, Ts &>::type...>::type;
+        return visit_index<R>([&] (auto i) -> R {
+            return std::invoke(std::forward<Lambda>(lambda), variant_union_get<i>(m_union));
+        });
     }
 
     template <class Lambda>
-    std::common_type<typename std::invoke_result<Lambda, Ts const &>::type...>::type visit(Lambda &&lambda) const {
-        return const_visitors_table<Lambda>()[index()](m_union, std::forward<Lambda>(lambda));
+    constexpr std::common_type<typename std::invoke_result<Lambda, Ts const &>::type...>::type visit(Lambda &&lambda) const {
+        using R = std::common_type<typename std::invoke_result<Lambda, Ts const &>::type...>::type;
+        return visit_index<R>([&] (auto i) -> R {
+            return std::invoke(std::forward<Lambda>(lambda), variant_union_get<i>(m_union));
+        });
     }
 
     constexpr size_t index() const noexcept {
-        return m_index;
+        if constexpr (Niche::value) {
+            using D = std::remove_cv_t<typename VariantAlternative<Variant, Niche::dataful>::type>;
+            size_t k = NicheTraits<D>::_S_load(&m_union);
+            if (k == NicheTraits<D>::count)
+                return Niche::dataful;
+            return k < Niche::dataful ? k : k + 1;
+        } else {
+            return m_index;
+        }
     }
 
     template <typename T>
@@ -182,54 +329,54 @@ public:
     }
 
     template <size_t I>
-    typename VariantAlternative<Variant, I>::type &get() {
+    constexpr typename VariantAlternative<Variant, I>::type &get() {
         static_assert(I < sizeof...(Ts), "I out of range!");
-        if (m_index != I)
+        if (index() != I)
             throw BadVariantAccess();
-        return *reinterpret_cast<typename VariantAlternative<Variant, I>::type *>(m_union);
+        return variant_union_get<I>(m_union);
     }
 
     template <typename T>
-    T &get() {
+    constexpr T &get() {
         return get<VariantIndex<Variant, T>::value>();
     }
 
     template <size_t I>
-    typename VariantAlternative<Variant, I>::type const &get() const {
+    constexpr typename VariantAlternative<Variant, I>::type const &get() const {
         static_assert(I < sizeof...(Ts), "I out of range!");
-        if (m_index != I)
+        if (index() != I)
             throw BadVariantAccess();
-        return *reinterpret_cast<typename VariantAlternative<Variant, I>::type const *>(m_union);
+        return variant_union_get<I>(m_union);
     }
 
     template <typename T>
-    T const &get() const {
+    constexpr T const &get() const {
         return get<VariantIndex<Variant, T>::value>();
     }
 
     template <size_t I>
-    typename VariantAlternative<Variant, I>::type *get_if() {
+    constexpr typename VariantAlternative<Variant, I>::type *get_if() {
         static_assert(I < sizeof...(Ts), "I out of range!");
-        if (m_index != I)
+        if (index() != I)
             return nullptr;
-        return reinterpret_cast<typename VariantAlternative<Variant, I>::type *>(m_union);
+        return &variant_union_get<I>(m_union);
     }
 
     template <typename T>
-    T *get_if() {
+    constexpr T *get_if() {
         return get_if<VariantIndex<Variant, T>::value>();
     }
 
     template <size_t I>
-    typename VariantAlternative<Variant, I>::type const *get_if() const {
+    constexpr typename VariantAlternative<Variant, I>::type const *get_if() const {
         static_assert(I < sizeof...(Ts), "I out of range!");
-        if (m_index != I)
+        if (index() != I)
             return nullptr;
-        return reinterpret_cast<typename VariantAlternative<Variant, I>::type const *>(m_union);
+        return &variant_union_get<I>(m_union);
     }
 
     template <typename T>
-    T const *get_if() const {
+    constexpr T const *get_if() const {
         return get_if<VariantIndex<Variant, T>::value>();
     }
 };
@@ -253,3 +400,63 @@ template <typename T0, typename T, typename ...Ts>
 struct VariantIndex<Variant<T0, Ts...>, T> {
     static constexpr size_t value = VariantIndex<Variant<Ts...>, T>::value + 1;
 };
+
+template <typename ...Ts>
+struct VariantSize<Variant<Ts...>> {
+    static constexpr size_t value = sizeof...(Ts);
+};
+
+// 不检查 index 直接取出第 I 个可选类型，保持 V 的 const 与值类别：Variant & 得到 T &，Variant && 得到 T &&
+struct VariantAccess {
+    template <size_t I, class V>
+    static constexpr decltype(auto) get(V &&v) noexcept {
+        auto &value = variant_union_get<I>(v.m_union);
+        if constexpr (std::is_lvalue_reference_v<V>)
+            return value;
+        else
+            return std::move(value);
+    }
+};
+
+// 多个 Variant 的 visit：把 N 维的 index 组合压平成一维下标，再经 variant_visit_index 分派，一次跳转完成
+// 例如 Variant<int, double> 与 Variant<int, double, float> 共 2 * 3 = 6 项，下标为 i0 * 3 + i1，不超过 16 项时同样生成 switch
+template <class R, class Lambda, class ...Vs>
+struct VariantMultiVisit {
+    static constexpr size_t sizes[] = {VariantSize<std::remove_cvref_t<Vs>>::value...};
+
+    // 第 K 个 Variant 在压平下标中的步长，等于它之后所有 Variant 可选类型数的乘积
+    static constexpr size_t stride(size_t k) noexcept {
+        size_t s = 1;
+        for (size_t i = k + 1; i < sizeof...(Vs); i++)
+            s *= sizes[i];
+        return s;
+    }
+
+    static constexpr size_t total = (VariantSize<std::remove_cvref_t<Vs>>::value * ...);
+
+    template <size_t ...Ks>
+    static constexpr R visit(std::index_sequence<Ks...>, Lambda &&lambda, Vs &&...vs) {
+        size_t flat = 0;
+        ((flat = flat * sizes[Ks] + vs.index()), ...);
+        return variant_visit_index<total, R>(flat, [&] (auto f) -> R {
+            return std::invoke(std::forward<Lambda>(lambda),
+                               VariantAccess::get<f / stride(Ks) % sizes[Ks]>(std::forward<Vs>(vs))...);
+        });
+    }
+};
+
+template <typename>
+struct IsVariant : std::false_type {};
+
+template <typename ...Ts>
+struct IsVariant<Variant<Ts...>> : std::true_type {};
+
+// 同 std::visit，返回类型取所有 Variant 都处于第 0 个可选类型时的调用结果
+// 只接受 Variant，否则对 std::variant 的无限定调用 visit(f, v) 会与经 ADL 找到的 std::visit 产生歧义
+template <class Lambda, class ...Vs, std::enable_if_t<(IsVariant<std::remove_cvref_t<Vs>>::value && ...), int> = 0>
+constexpr decltype(auto) visit(Lambda &&lambda, Vs &&...vs) {
+    static_assert(sizeof...(Vs) > 0, "visit requires at least one Variant");
+    using R = std::invoke_result_t<Lambda, decltype(VariantAccess::get<0>(std::declval<Vs>()))...>;
+    return VariantMultiVisit<R, Lambda, Vs...>::visit(std::index_sequence_for<Vs...>(),
+                                                      std::forward<Lambda>(lambda), std::forward<Vs>(vs)...);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstring>
 #include <iterator>
 #include <memory>
 #include <limits>
@@ -138,11 +139,16 @@ public:
             _M_cap = __n;
         }
         if (__old_cap != 0) {
-            for (std::size_t __i = 0; __i != _M_size; __i++) {
-                std::construct_at(&_M_data[__i], std::move_if_noexcept(__old_data[__i]));
-            }
-            for (std::size_t __i = 0; __i != _M_size; __i++) {
-                std::destroy_at(&__old_data[__i]);
+            if constexpr (std::is_trivially_copyable_v<_Tp>) { // 可平凡拷贝的类型（如 Optional<int>）直接按字节搬运
+                if (_M_size != 0)
+                    std::memcpy(_M_data, __old_data, _M_size * sizeof(_Tp));
+            } else {
+                for (std::size_t __i = 0; __i != _M_size; __i++) {
+                    std::construct_at(&_M_data[__i], std::move_if_noexcept(__old_data[__i]));
+                }
+                for (std::size_t __i = 0; __i != _M_size; __i++) {
+                    std::destroy_at(&__old_data[__i]);
+                }
             }
             _M_alloc.deallocate(__old_data, __old_cap);
         }
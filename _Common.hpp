@@ -10,6 +10,9 @@
 #include <compare>
 #endif
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 #if __cpp_concepts && __cpp_lib_concepts
 # define _LIBPENGCXX_REQUIRES_ITERATOR_CATEGORY(__category, _Type) \
@@ -42,6 +45,13 @@
 #define _LIBPENGCXX_UNREACHABLE() do {} while (1)
 #endif
 
+// 以 -fno-rtti 或 /GR- 编译时 typeid 不可用，依赖它的接口（如 Function::target_type）随之关闭
+#if defined(__GXX_RTTI) || defined(_CPPRTTI)
+#define _LIBPENGCXX_HAS_RTTI 1
+#else
+#define _LIBPENGCXX_HAS_RTTI 0
+#endif
+
 #if __cpp_lib_three_way_comparison
 #define _LIBPENGCXX_DEFINE_COMPARISON(_Type) \
     bool operator==(_Type const &__that) const noexcept { \
@@ -77,3 +87,49 @@
         return !(*this < __that); \
     }
 #endif
+
+// 类型的“空闲取值”：对象表示中合法对象永远不会出现的位模式，Variant 可以把 index 藏在其中，省去单独的 index 字段
+// count 为空闲取值的个数；_S_store(__p, __k) 把第 __k 个空闲取值写入 __p 处的对象表示，
+// _S_load(__p) 在 __p 处是第 __k 个空闲取值时返回 __k，否则（是一个合法对象）返回 count
+// 自定义类型可以特化此模板来声明自己的空闲取值
+template <class _Tp>
+struct NicheTraits {
+    static constexpr std::size_t count = 0;
+};
+
+// bool 只有 0 和 1 两种合法取值，其余 254 种都是空闲的
+template <>
+struct NicheTraits<bool> {
+    static constexpr std::size_t count = 254;
+
+    static void _S_store(void *__p, std::size_t __k) noexcept {
+        *static_cast<unsigned char *>(__p) = static_cast<unsigned char>(__k + 2);
+    }
+
+    static std::size_t _S_load(void const *__p) noexcept {
+        unsigned char __b = *static_cast<unsigned char const *>(__p);
+        return __b >= 2 ? __b - 2 : count;
+    }
+};
+
+// 指针的空闲取值需要显式开启：地址 1 到 255 落在主流平台上永不映射的第 0 页内，不会是合法对象的地址（nullptr 仍是合法取值）
+// 但合法的程序可以在指针里存放这些值（如 reinterpret_cast<Node *>(1) 这样的墓碑标记，或塞进 void * 的小整数），所以不默认启用
+// 确认自己的指针类型从不存放这类值时，用户可以这样声明：template <> struct NicheTraits<Node *> : NichePointerTraits<Node *> {};
+// 不按所指类型的对齐取低位，这样所指类型尚不完整时（如树节点里的 Variant<Node *, ...>）也能使用
+template <class _Ptr>
+struct NichePointerTraits {
+    static_assert(std::is_pointer_v<_Ptr>, "NichePointerTraits only applies to pointer types");
+
+    static constexpr std::size_t count = 255;
+
+    static void _S_store(void *__p, std::size_t __k) noexcept {
+        std::uintptr_t __v = __k + 1;
+        std::memcpy(__p, &__v, sizeof(__v));
+    }
+
+    static std::size_t _S_load(void const *__p) noexcept {
+        std::uintptr_t __v;
+        std::memcpy(&__v, __p, sizeof(__v));
+        return __v - 1 < count ? std::size_t(__v - 1) : count;
+    }
+};
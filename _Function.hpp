@@ -1,10 +1,13 @@
 #pragma once
 
+#include <cstddef>
+#include <new>
 #include <utility>
 #include <typeinfo>
 #include <memory>
 #include <type_traits>
 #include <functional>
+#include "_Common.hpp"
 
 template <class _FnSig>
 struct Function {
@@ -16,40 +19,115 @@ struct Function {
 template <class _Ret, class ..._Args>
 struct Function<_Ret(_Args...)> {
 private:
-    struct _FuncBase {
-        virtual _Ret _M_call(_Args ...__args) = 0; // 类型擦除后的统一接口
-        virtual std::unique_ptr<_FuncBase> _M_clone() const = 0; // 原型模式，克隆当前函数对象
-        virtual std::type_info const &_M_type() const = 0; // 获得函数对象类型信息
-        virtual ~_FuncBase() = default; // 应对_Fn可能有非平凡析构的情况
+    // 小对象优化：不超过 3 个指针大小、且移动构造不抛异常的仿函数直接存放在 _M_buf 中，否则放在堆上
+    union _Storage {
+        void *_M_ptr;
+        alignas(void *) unsigned char _M_buf[3 * sizeof(void *)];
+    };
+
+    // 调用函数的指针直接存在 Function 对象里，调用时只需一次间接跳转，不用先经过虚表指针再取虚函数地址
+    using _Invoker = _Ret (*)(_Storage const &, _Args &&...);
+
+    // 除调用以外的操作较少用到，每种仿函数类型共用一张静态操作表，代替虚函数表
+    // 平凡的操作留空（nullptr），由 Function 直接按字节拷贝或什么都不做
+    struct _FuncOps {
+        void (*_M_move)(_Storage &__dst, _Storage &__src) noexcept; // 移动到 __dst 并析构 __src 中的对象
+        void (*_M_clone)(_Storage &__dst, _Storage const &__src); // 原型模式，克隆当前函数对象
+        void (*_M_destroy)(_Storage &__s) noexcept;
+#if _LIBPENGCXX_HAS_RTTI
+        std::type_info const *_M_type; // 函数对象类型信息
+#endif
     };
 
     template <class _Fn>
-    struct _FuncImpl : _FuncBase { // FuncImpl 会被实例化多次，每个不同的仿函数类都产生一次实例化
-        _Fn _M_f;
+    struct _FuncImpl { // FuncImpl 会被实例化多次，每个不同的仿函数类都产生一次实例化
+        static constexpr bool _S_inline = sizeof(_Fn) <= sizeof(_Storage) && alignof(_Fn) <= alignof(_Storage)
+            && std::is_nothrow_move_constructible_v<_Fn>;
+
+        static _Fn *_S_get(_Storage const &__s) noexcept {
+            if constexpr (_S_inline)
+                return std::launder(reinterpret_cast<_Fn *>(const_cast<unsigned char *>(__s._M_buf)));
+            else
+                return static_cast<_Fn *>(__s._M_ptr);
+        }
 
         template <class ..._CArgs>
-        explicit _FuncImpl(std::in_place_t, _CArgs &&...__args) : _M_f(std::forward<_CArgs>(__args)...) {}
+        static void _S_create(_Storage &__s, _CArgs &&...__args) {
+            if constexpr (_S_inline)
+                ::new (static_cast<void *>(__s._M_buf)) _Fn(std::forward<_CArgs>(__args)...);
+            else
+                __s._M_ptr = new _Fn(std::forward<_CArgs>(__args)...);
+        }
+
+        static _Ret _S_invoke(_Storage const &__s, _Args &&...__args) {
+            // 完美转发所有参数给构造时保存的仿函数对象
+            // 返回值允许隐式转换为 _Ret，_Ret 为 void 时丢弃仿函数的返回值
+            if constexpr (std::is_void_v<_Ret>)
+                std::invoke(*_S_get(__s), std::forward<_Args>(__args)...);
+            else
+                return std::invoke(*_S_get(__s), std::forward<_Args>(__args)...);
+        }
 
-        _Ret _M_call(_Args ...__args) override {
-            // 完美转发所有参数给构造时保存的仿函数对象：
-            // return _M_f(std::forward<Args>(__args)...);
-            // 更规范的写法其实是：
-            return std::invoke(_M_f, std::forward<_Args>(__args)...);
+        static void _S_move(_Storage &__dst, _Storage &__src) noexcept {
+            _Fn *__f = _S_get(__src);
+            ::new (static_cast<void *>(__dst._M_buf)) _Fn(std::move(*__f));
+            __f->~_Fn();
         }
 
-        std::unique_ptr<_FuncBase> _M_clone() const override {
-            return std::make_unique<_FuncImpl>(std::in_place, _M_f);
+        static void _S_clone(_Storage &__dst, _Storage const &__src) {
+            _S_create(__dst, *_S_get(__src));
         }
 
-        std::type_info const &_M_type() const override {
-            return typeid(_Fn);
+        static void _S_destroy(_Storage &__s) noexcept {
+            if constexpr (_S_inline)
+                _S_get(__s)->~_Fn();
+            else
+                delete _S_get(__s);
         }
+
+        // 堆上的对象移动时只需拷贝指针，可平凡拷贝的内联对象直接拷贝字节
+        static constexpr bool _S_trivial_move = !_S_inline || std::is_trivially_copyable_v<_Fn>;
+        static constexpr bool _S_trivial_destroy = _S_inline && std::is_trivially_destructible_v<_Fn>;
+
+        static constexpr _FuncOps _S_ops = {
+            _S_trivial_move ? nullptr : _S_move,
+            _S_clone,
+            _S_trivial_destroy ? nullptr : _S_destroy,
+#if _LIBPENGCXX_HAS_RTTI
+            &typeid(_Fn),
+#endif
+        };
     };
 
-    std::unique_ptr<_FuncBase> _M_base; // 使用智能指针管理仿函数对象
+    [[noreturn]] static _Ret _S_empty_invoke(_Storage const &, _Args &&...) {
+        throw std::bad_function_call();
+    }
+
+    _Invoker _M_invoke; // 为空时指向 _S_empty_invoke，调用时无需再判断是否为空
+    _FuncOps const *_M_ops; // 为空时为 nullptr
+    _Storage _M_storage;
+
+    void _M_reset() noexcept {
+        if (_M_ops && _M_ops->_M_destroy)
+            _M_ops->_M_destroy(_M_storage);
+        _M_invoke = _S_empty_invoke;
+        _M_ops = nullptr;
+    }
+
+    // 从 __that 中夺取仿函数对象，调用前 *this 应为空
+    void _M_steal(Function &__that) noexcept {
+        _M_invoke = __that._M_invoke;
+        _M_ops = __that._M_ops;
+        if (_M_ops && _M_ops->_M_move)
+            _M_ops->_M_move(_M_storage, __that._M_storage);
+        else
+            _M_storage = __that._M_storage;
+        __that._M_invoke = _S_empty_invoke;
+        __that._M_ops = nullptr;
+    }
 
 public:
-    Function() = default; // _M_base 初始化为 nullptr
+    Function() noexcept : _M_invoke(_S_empty_invoke), _M_ops(nullptr) {}
     Function(std::nullptr_t) noexcept : Function() {}
 
     // 此处 enable_if_t 的作用：阻止 Function 从不可调用的对象中初始化
@@ -58,51 +136,74 @@ public:
                                         && std::is_copy_constructible_v<_Fn> 
                                         && !std::is_same_v<std::decay_t<_Fn>, Function<_Ret(_Args...)>> >>
     Function(_Fn &&__f) // 没有 explicit，允许 lambda 表达式隐式转换成 Function
-    : _M_base(std::make_unique<_FuncImpl<std::decay_t<_Fn>>>(std::in_place, std::forward<_Fn>(__f)))
-    {}
+    {
+        using _Impl = _FuncImpl<std::decay_t<_Fn>>;
+        _Impl::_S_create(_M_storage, std::forward<_Fn>(__f));
+        _M_invoke = _Impl::_S_invoke;
+        _M_ops = &_Impl::_S_ops;
+    }
 
-    Function(Function &&) = default;
-    Function &operator=(Function &&) = default;
+    Function(Function &&__that) noexcept {
+        _M_steal(__that);
+    }
 
-    Function(Function const &__that) : _M_base(__that._M_base ? __that._M_base->_M_clone() : nullptr) {
+    Function &operator=(Function &&__that) noexcept {
+        if (this != &__that) [[likely]] {
+            _M_reset();
+            _M_steal(__that);
+        }
+        return *this;
+    }
+
+    Function(Function const &__that) : _M_invoke(__that._M_invoke), _M_ops(__that._M_ops) {
+        if (_M_ops)
+            _M_ops->_M_clone(_M_storage, __that._M_storage);
     }
 
     Function &operator=(Function const &__that) {
-        if (__that._M_base)
-            _M_base = __that._M_base->_M_clone();
-        else
-            _M_base = nullptr;
+        if (this != &__that) [[likely]] {
+            Function __tmp(__that); // 先克隆再替换，克隆抛出异常时 *this 保持不变
+            *this = std::move(__tmp);
+        }
+        return *this;
+    }
+
+    ~Function() noexcept {
+        _M_reset();
     }
 
     explicit operator bool() const noexcept {
-        return _M_base != nullptr;
+        return _M_ops != nullptr;
     }
 
     bool operator==(std::nullptr_t) const noexcept {
-        return _M_base == nullptr;
+        return _M_ops == nullptr;
     }
 
     bool operator!=(std::nullptr_t) const noexcept {
-        return _M_base != nullptr;
+        return _M_ops != nullptr;
     }
 
     _Ret operator()(_Args ...__args) const {
-        if (!_M_base) [[unlikely]]
-            throw std::bad_function_call();
         // 完美转发所有参数，这样即使 Args 中具有引用，也能不产生额外的拷贝开销
-        return _M_base->_M_call(std::forward<_Args>(__args)...);
+        return _M_invoke(_M_storage, std::forward<_Args>(__args)...);
     }
 
+#if _LIBPENGCXX_HAS_RTTI
     std::type_info const &target_type() const noexcept {
-        return _M_base ? _M_base->_M_type() : typeid(void);
+        return _M_ops ? *_M_ops->_M_type : typeid(void);
     }
+#endif
 
+    // 每种仿函数类型的操作表地址唯一，比较表的地址即可判断类型，不需要 RTTI
     template <class _Fn>
     _Fn *target() const noexcept {
-        return _M_base && typeid(_Fn) == _M_base->_M_type() ? std::addressof(static_cast<_FuncImpl<_Fn> *>(_M_base.get())->_M_f) : nullptr;
+        return _M_ops == &_FuncImpl<_Fn>::_S_ops ? _FuncImpl<_Fn>::_S_get(_M_storage) : nullptr;
     }
 
-    void swap(Function &__that) const noexcept {
-        _M_base.swap(__that._M_base);
+    void swap(Function &__that) noexcept {
+        Function __tmp(std::move(__that));
+        __that = std::move(*this);
+        *this = std::move(__tmp);
     }
 };
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <functional>
+
+template <class _FnSig>
+struct FunctionRef {
+    // 只在使用了不符合 Ret(Args...) 模式的 FnSig 时会进入此特化，导致报错
+    // 此处表达式始终为 false，仅为避免编译期就报错，才让其依赖模板参数
+    static_assert(!std::is_same_v<_FnSig, _FnSig>, "not a valid function signature");
+};
+
+// 不持有仿函数对象的引用，只有两个指针：仿函数对象的地址与调用它的函数
+// 从不分配内存，可以平凡拷贝，适合作为只在函数调用期间使用回调的参数类型
+// 注意：与 std::string_view 一样，FunctionRef 不延长所引用对象的生命周期
+template <class _Ret, class ..._Args>
+struct FunctionRef<_Ret(_Args...)> {
+private:
+    union _Target {
+        void *_M_obj;
+        void (*_M_fn)(); // 函数指针不能保证可以转换为 void *，单独存放
+    };
+
+    using _Invoker = _Ret (*)(_Target, _Args &&...);
+
+    _Target _M_target;
+    _Invoker _M_invoke;
+
+    template <class _Fn>
+    static _Ret _S_invoke_obj(_Target __t, _Args &&...__args) {
+        _Fn &__f = *static_cast<_Fn *>(__t._M_obj);
+        if constexpr (std::is_void_v<_Ret>)
+            std::invoke(__f, std::forward<_Args>(__args)...);
+        else
+            return std::invoke(__f, std::forward<_Args>(__args)...);
+    }
+
+    template <class _Fp>
+    static _Ret _S_invoke_fn(_Target __t, _Args &&...__args) {
+        _Fp __f = reinterpret_cast<_Fp>(__t._M_fn);
+        if constexpr (std::is_void_v<_Ret>)
+            std::invoke(__f, std::forward<_Args>(__args)...);
+        else
+            return std::invoke(__f, std::forward<_Args>(__args)...);
+    }
+
+public:
+    // 函数指针直接保存其值，不引用临时的指针变量
+    template <class _Fp, class = std::enable_if_t<std::is_function_v<_Fp>
+                                                  && std::is_invocable_r_v<_Ret, _Fp &, _Args...>>>
+    FunctionRef(_Fp *__f) noexcept : _M_invoke(_S_invoke_fn<_Fp *>) {
+        _M_target._M_fn = reinterpret_cast<void (*)()>(__f);
+    }
+
+    // 没有 explicit，允许 lambda 表达式隐式转换成 FunctionRef
+    template <class _Fn, class = std::enable_if_t<!std::is_same_v<std::remove_cvref_t<_Fn>, FunctionRef>
+                                                  && !std::is_pointer_v<std::remove_cvref_t<_Fn>>
+                                                  && std::is_invocable_r_v<_Ret, std::remove_reference_t<_Fn> &, _Args...>>>
+    FunctionRef(_Fn &&__f) noexcept : _M_invoke(_S_invoke_obj<std::remove_reference_t<_Fn>>) {
+        _M_target._M_obj = const_cast<void *>(static_cast<void const volatile *>(std::addressof(__f)));
+    }
+
+    FunctionRef(FunctionRef const &) = default;
+    FunctionRef &operator=(FunctionRef const &) = default;
+
+    _Ret operator()(_Args ...__args) const {
+        // 完美转发所有参数，这样即使 Args 中具有引用，也能不产生额外的拷贝开销
+        return _M_invoke(_M_target, std::forward<_Args>(__args)...);
+    }
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cassert>
+#include <cstddef>
+#include <new>
 #include <utility>
 #include <memory>
 #include <type_traits>
@@ -12,72 +15,225 @@ struct MoveOnlyFunction {
     static_assert(!std::is_same_v<_FnSig, _FnSig>, "not a valid function signature");
 };
 
-template <class _Ret, class ..._Args>
-struct MoveOnlyFunction<_Ret(_Args...)> {
-private:
-    struct _FuncBase {
-        virtual _Ret _M_call(_Args ...__args) = 0; // 类型擦除后的统一接口
-        virtual ~_FuncBase() = default; // 应对_Fn可能有非平凡析构的情况
+// 与签名上的 const、&、&& 限定无关的部分：存储、操作表、移动与析构
+// 布局同 Function：调用函数指针 + 静态操作表指针 + 3 个指针大小的内联缓冲区
+template <class _Ret, bool _Noex, class ..._Args>
+struct _MoveOnlyFunctionBase {
+protected:
+    // 小对象优化：不超过 3 个指针大小、且移动构造不抛异常的仿函数直接存放在 _M_buf 中，否则放在堆上
+    // 捕获了一个 UniquePtr 的 lambda 这类只能移动的小仿函数同样内联存放，任务队列因此无需分配内存
+    union _Storage {
+        void *_M_ptr;
+        alignas(void *) unsigned char _M_buf[3 * sizeof(void *)];
+    };
+
+    using _Invoker = _Ret (*)(_Storage const &, _Args &&...) noexcept(_Noex);
+
+    // 平凡的操作留空（nullptr），直接按字节拷贝或什么都不做
+    struct _FuncOps {
+        void (*_M_move)(_Storage &__dst, _Storage &__src) noexcept; // 移动到 __dst 并析构 __src 中的对象
+        void (*_M_destroy)(_Storage &__s) noexcept;
     };
 
     template <class _Fn>
-    struct _FuncImpl : _FuncBase { // FuncImpl 会被实例化多次，每个不同的仿函数类都产生一次实例化
-        _Fn _M_f;
+    struct _FuncImpl { // FuncImpl 会被实例化多次，每个不同的仿函数类都产生一次实例化
+        static constexpr bool _S_inline = sizeof(_Fn) <= sizeof(_Storage) && alignof(_Fn) <= alignof(_Storage)
+            && std::is_nothrow_move_constructible_v<_Fn>;
+
+        static _Fn *_S_get(_Storage const &__s) noexcept {
+            if constexpr (_S_inline)
+                return std::launder(reinterpret_cast<_Fn *>(const_cast<unsigned char *>(__s._M_buf)));
+            else
+                return static_cast<_Fn *>(__s._M_ptr);
+        }
 
         template <class ..._CArgs>
-        explicit _FuncImpl(std::in_place_t, _CArgs &&...__args) : _M_f(std::forward(__args)...) {}
+        static void _S_create(_Storage &__s, _CArgs &&...__args) {
+            if constexpr (_S_inline)
+                ::new (static_cast<void *>(__s._M_buf)) _Fn(std::forward<_CArgs>(__args)...);
+            else
+                __s._M_ptr = new _Fn(std::forward<_CArgs>(__args)...);
+        }
+
+        // _Inv 是调用时仿函数对象应有的类型，带上签名中的 const 与引用限定，如 _Fn const & 或 _Fn &&
+        template <class _Inv>
+        static _Ret _S_invoke(_Storage const &__s, _Args &&...__args) noexcept(_Noex) {
+            if constexpr (std::is_void_v<_Ret>)
+                std::invoke(static_cast<_Inv>(*_S_get(__s)), std::forward<_Args>(__args)...);
+            else
+                return std::invoke(static_cast<_Inv>(*_S_get(__s)), std::forward<_Args>(__args)...);
+        }
+
+        static void _S_move(_Storage &__dst, _Storage &__src) noexcept {
+            _Fn *__f = _S_get(__src);
+            ::new (static_cast<void *>(__dst._M_buf)) _Fn(std::move(*__f));
+            __f->~_Fn();
+        }
 
-        _Ret _M_call(_Args ...__args) override {
-            // 完美转发所有参数给构造时保存的仿函数对象：
-            // return _M_f(std::forward<Args>(__args)...);
-            // 更规范的写法其实是：
-            return std::invoke(_M_f, std::forward<_Args>(__args)...);
+        static void _S_destroy(_Storage &__s) noexcept {
+            if constexpr (_S_inline)
+                _S_get(__s)->~_Fn();
+            else
+                delete _S_get(__s);
         }
+
+        static constexpr bool _S_trivial_move = !_S_inline || std::is_trivially_copyable_v<_Fn>;
+        static constexpr bool _S_trivial_destroy = _S_inline && std::is_trivially_destructible_v<_Fn>;
+
+        static constexpr _FuncOps _S_ops = {
+            _S_trivial_move ? nullptr : _S_move,
+            _S_trivial_destroy ? nullptr : _S_destroy,
+        };
     };
 
-    std::unique_ptr<_FuncBase> _M_base; // 使用智能指针管理仿函数对象
+    _Invoker _M_invoke; // 为空时为 nullptr
+    _FuncOps const *_M_ops;
+    _Storage _M_storage;
+
+    template <class _Fn, class _Inv, class ..._CArgs>
+    void _M_init(_CArgs &&...__args) {
+        // 空的函数指针、成员指针构造出空的 MoveOnlyFunction
+        // 实参是函数名时传进来的是函数引用，不可能为空，不做比较（否则 GCC 会给出 -Wnonnull-compare 警告）
+        if constexpr ((std::is_pointer_v<_Fn> || std::is_member_pointer_v<_Fn>)
+                      && ((std::is_pointer_v<std::remove_cvref_t<_CArgs>>
+                           || std::is_member_pointer_v<std::remove_cvref_t<_CArgs>>) && ...)) {
+            if (((__args == nullptr) || ...))
+                return;
+        }
+        _FuncImpl<_Fn>::_S_create(_M_storage, std::forward<_CArgs>(__args)...);
+        _M_invoke = _FuncImpl<_Fn>::template _S_invoke<_Inv>;
+        _M_ops = &_FuncImpl<_Fn>::_S_ops;
+    }
 
-public:
-    MoveOnlyFunction() = default; // _M_base 初始化为 nullptr
-    MoveOnlyFunction(std::nullptr_t) noexcept : MoveOnlyFunction() {}
-
-    // 此处 enable_if_t 的作用：阻止 MoveOnlyFunction 从不可调用的对象中初始化
-    // MoveOnlyFunction 不要求支持拷贝
-    template <class _Fn, class = std::enable_if_t<std::is_invocable_r_v<_Ret, _Fn &, _Args...>>>
-    MoveOnlyFunction(_Fn __f) // 没有 explicit，允许 lambda 表达式隐式转换成 MoveOnlyFunction
-    : _M_base(std::make_unique<_FuncImpl<_Fn>>(std::in_place, std::move(__f)))
-    {}
-
-    // 就地构造的版本
-    template <class _Fn, class ..._CArgs>
-    explicit MoveOnlyFunction(std::in_place_type_t<_Fn>, _CArgs &&...__args)
-    : _M_base(std::make_unique<_FuncImpl<_Fn>>(std::in_place, std::forward<_CArgs>(__args)...))
-    {}
-
-    MoveOnlyFunction(MoveOnlyFunction &&) = default;
-    MoveOnlyFunction &operator=(MoveOnlyFunction &&) = default;
-    MoveOnlyFunction(MoveOnlyFunction const &) = delete;
-    MoveOnlyFunction &operator=(MoveOnlyFunction const &) = delete;
+    void _M_reset() noexcept {
+        if (_M_ops && _M_ops->_M_destroy)
+            _M_ops->_M_destroy(_M_storage);
+        _M_invoke = nullptr;
+        _M_ops = nullptr;
+    }
 
-    explicit operator bool() const noexcept {
-        return _M_base != nullptr;
+    // 从 __that 中夺取仿函数对象，调用前 *this 应为空
+    void _M_steal(_MoveOnlyFunctionBase &__that) noexcept {
+        _M_invoke = __that._M_invoke;
+        _M_ops = __that._M_ops;
+        if (_M_ops && _M_ops->_M_move)
+            _M_ops->_M_move(_M_storage, __that._M_storage);
+        else
+            _M_storage = __that._M_storage;
+        __that._M_invoke = nullptr;
+        __that._M_ops = nullptr;
     }
 
-    bool operator==(std::nullptr_t) const noexcept {
-        return _M_base == nullptr;
+    _MoveOnlyFunctionBase() noexcept : _M_invoke(nullptr), _M_ops(nullptr) {}
+
+    _MoveOnlyFunctionBase(_MoveOnlyFunctionBase &&__that) noexcept {
+        _M_steal(__that);
     }
 
-    bool operator!=(std::nullptr_t) const noexcept {
-        return _M_base != nullptr;
+    _MoveOnlyFunctionBase &operator=(_MoveOnlyFunctionBase &&__that) noexcept {
+        if (this != &__that) [[likely]] {
+            _M_reset();
+            _M_steal(__that);
+        }
+        return *this;
     }
 
-    _Ret operator()(_Args ...__args) const {
-        assert(_M_base);
-        // 完美转发所有参数，这样即使 Args 中具有引用，也能不产生额外的拷贝开销
-        return _M_base->_M_call(std::forward<_Args>(__args)...);
+    ~_MoveOnlyFunctionBase() noexcept {
+        _M_reset();
     }
 
-    void swap(MoveOnlyFunction &__that) const noexcept {
-        _M_base.swap(__that._M_base);
+public:
+    explicit operator bool() const noexcept {
+        return _M_invoke != nullptr;
+    }
+
+    bool operator==(std::nullptr_t) const noexcept {
+        return _M_invoke == nullptr;
+    }
+
+    bool operator!=(std::nullptr_t) const noexcept {
+        return _M_invoke != nullptr;
     }
 };
+
+template <class _Tp>
+inline constexpr bool _S_is_in_place_type = false;
+
+template <class _Tp>
+inline constexpr bool _S_is_in_place_type<std::in_place_type_t<_Tp>> = true;
+
+// 为每种限定组合生成一个特化，同 std::move_only_function：
+// _CV 与 _REF 是签名上的限定，_INV_REF 是调用仿函数时所用的引用类型（无引用限定时按左值调用），_NOEX 表示是否 noexcept
+#define _LIBPENGCXX_MOVE_ONLY_FUNCTION(_CV, _REF, _INV_REF, _NOEX) \
+template <class _Ret, class ..._Args> \
+struct MoveOnlyFunction<_Ret(_Args...) _CV _REF noexcept(_NOEX)> : _MoveOnlyFunctionBase<_Ret, _NOEX, _Args...> { \
+private: \
+    template <class _Fn> \
+    static constexpr bool _S_callable = _NOEX \
+        ? std::is_nothrow_invocable_r_v<_Ret, _Fn _CV _INV_REF, _Args...> \
+        : std::is_invocable_r_v<_Ret, _Fn _CV _INV_REF, _Args...>; \
+\
+public: \
+    MoveOnlyFunction() noexcept = default; \
+    MoveOnlyFunction(std::nullptr_t) noexcept {} \
+\
+    /* 没有 explicit，允许 lambda 表达式隐式转换成 MoveOnlyFunction；不要求仿函数支持拷贝 */ \
+    template <class _Fn, class = std::enable_if_t<!std::is_same_v<std::remove_cvref_t<_Fn>, MoveOnlyFunction> \
+                                                  && !_S_is_in_place_type<std::remove_cvref_t<_Fn>> \
+                                                  && _S_callable<std::decay_t<_Fn>>>> \
+    MoveOnlyFunction(_Fn &&__f) { \
+        this->template _M_init<std::decay_t<_Fn>, std::decay_t<_Fn> _CV _INV_REF>(std::forward<_Fn>(__f)); \
+    } \
+\
+    /* 就地构造的版本 */ \
+    template <class _Fn, class ..._CArgs, class = std::enable_if_t<_S_callable<_Fn>>> \
+    explicit MoveOnlyFunction(std::in_place_type_t<_Fn>, _CArgs &&...__args) { \
+        this->template _M_init<_Fn, _Fn _CV _INV_REF>(std::forward<_CArgs>(__args)...); \
+    } \
+\
+    MoveOnlyFunction(MoveOnlyFunction &&) = default; \
+    MoveOnlyFunction &operator=(MoveOnlyFunction &&) = default; \
+    MoveOnlyFunction(MoveOnlyFunction const &) = delete; \
+    MoveOnlyFunction &operator=(MoveOnlyFunction const &) = delete; \
+\
+    MoveOnlyFunction &operator=(std::nullptr_t) noexcept { \
+        this->_M_reset(); \
+        return *this; \
+    } \
+\
+    template <class _Fn, class = std::enable_if_t<std::is_constructible_v<MoveOnlyFunction, _Fn>>> \
+    MoveOnlyFunction &operator=(_Fn &&__f) { \
+        return *this = MoveOnlyFunction(std::forward<_Fn>(__f)); \
+    } \
+\
+    _Ret operator()(_Args ...__args) _CV _REF noexcept(_NOEX) { \
+        assert(this->_M_invoke); \
+        /* 完美转发所有参数，这样即使 Args 中具有引用，也能不产生额外的拷贝开销 */ \
+        return this->_M_invoke(this->_M_storage, std::forward<_Args>(__args)...); \
+    } \
+\
+    void swap(MoveOnlyFunction &__that) noexcept { \
+        MoveOnlyFunction __tmp(std::move(__that)); \
+        __that = std::move(*this); \
+        *this = std::move(__tmp); \
+    } \
+\
+    friend void swap(MoveOnlyFunction &__lhs, MoveOnlyFunction &__rhs) noexcept { \
+        __lhs.swap(__rhs); \
+    } \
+};
+
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(, , &, false)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(, &, &, false)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(, &&, &&, false)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(const, , &, false)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(const, &, &, false)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(const, &&, &&, false)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(, , &, true)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(, &, &, true)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(, &&, &&, true)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(const, , &, true)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(const, &, &, true)
+_LIBPENGCXX_MOVE_ONLY_FUNCTION(const, &&, &&, true)
+
+#undef _LIBPENGCXX_MOVE_ONLY_FUNCTION
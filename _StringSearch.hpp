@@ -0,0 +1,482 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// String 的查找算法：同一份算法模板分别以 AVX2 / SSSE3 / SSE2 / 纯标量的向量操作实例化
+// 与 Unicode.hpp 一样，运行时检测 CPU 支持的指令集，第一次调用时选定实现，之后都通过同一组函数指针调用
+// 因此不需要 -march 编译选项，默认的 x86-64 构建也能用上 AVX2 与 shuffle 查表
+// 所有函数都在 [__s, __s + __n) 范围内查找，返回相对 __s 的下标，找不到返回 _S_str_npos
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define _LIBPENGCXX_STRING_SIMD 1
+#define _LIBPENGCXX_STRING_DISPATCH 1
+#define _LIBPENGCXX_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define _LIBPENGCXX_TARGET_AVX2 __attribute__((target("avx2")))
+#define _LIBPENGCXX_STRING_KERNEL __attribute__((always_inline))
+#include <immintrin.h>
+#elif defined(_M_X64) // MSVC 没有 target 属性，只用 x86-64 一定支持的 SSE2
+#define _LIBPENGCXX_STRING_SIMD 1
+#define _LIBPENGCXX_STRING_KERNEL
+#include <immintrin.h>
+#else
+#define _LIBPENGCXX_STRING_KERNEL
+#endif
+
+inline constexpr std::size_t _S_str_npos = static_cast<std::size_t>(-1);
+
+#if _LIBPENGCXX_STRING_SIMD
+struct _StrSse2 { // 一次处理 16 字节
+    using _Vec = __m128i;
+
+    static constexpr std::size_t _S_width = 16;
+    static constexpr bool _S_has_shuffle = false;
+    static constexpr std::uint32_t _S_full_mask = 0xffffu;
+
+    static _Vec _S_load(char const *__p) noexcept {
+        return _mm_loadu_si128(reinterpret_cast<__m128i const *>(__p));
+    }
+
+    static _Vec _S_load_table(unsigned char const *__p) noexcept {
+        return _mm_loadu_si128(reinterpret_cast<__m128i const *>(__p));
+    }
+
+    static _Vec _S_splat(char __c) noexcept {
+        return _mm_set1_epi8(__c);
+    }
+
+    static std::uint32_t _S_eq_mask(_Vec __a, _Vec __b) noexcept {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(__a, __b)));
+    }
+
+    static std::uint32_t _S_eq2_mask(_Vec __a, _Vec __b, _Vec __c, _Vec __d) noexcept {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(__a, __b), _mm_cmpeq_epi8(__c, __d))));
+    }
+
+    static _Vec _S_and(_Vec __a, _Vec __b) noexcept {
+        return _mm_and_si128(__a, __b);
+    }
+
+    static _Vec _S_or(_Vec __a, _Vec __b) noexcept {
+        return _mm_or_si128(__a, __b);
+    }
+
+    static _Vec _S_xor(_Vec __a, _Vec __b) noexcept {
+        return _mm_xor_si128(__a, __b);
+    }
+
+    static _Vec _S_high_nibble(_Vec __a) noexcept {
+        return _mm_and_si128(_mm_srli_epi16(__a, 4), _mm_set1_epi8(0x0f));
+    }
+};
+#endif
+
+#if _LIBPENGCXX_STRING_DISPATCH
+struct _StrSsse3 : _StrSse2 { // 在 SSE2 的基础上多了 pshufb
+    static constexpr bool _S_has_shuffle = true;
+
+    _LIBPENGCXX_TARGET_SSSE3 static _Vec _S_shuffle(_Vec __table, _Vec __idx) noexcept {
+        return _mm_shuffle_epi8(__table, __idx);
+    }
+};
+
+struct _StrAvx2 { // 一次处理 32 字节
+    using _Vec = __m256i;
+
+    static constexpr std::size_t _S_width = 32;
+    static constexpr bool _S_has_shuffle = true;
+    static constexpr std::uint32_t _S_full_mask = 0xffffffffu;
+
+    _LIBPENGCXX_TARGET_AVX2 static _Vec _S_load(char const *__p) noexcept {
+        return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(__p));
+    }
+
+    _LIBPENGCXX_TARGET_AVX2 static _Vec _S_load_table(unsigned char const *__p) noexcept { // 16 字节表复制到两个 lane
+        return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(__p)));
+    }
+
+    _LIBPENGCXX_TARGET_AVX2 static _Vec _S_splat(char __c) noexcept {
+        return _mm256_set1_epi8(__c);
+    }
+
+    _LIBPENGCXX_TARGET_AVX2 static std::uint32_t _S_eq_mask(_Vec __a, _Vec __b) noexcept {
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(__a, __b)));
+    }
+
+    _LIBPENGCXX_TARGET_AVX2 static std::uint32_t _S_eq2_mask(_Vec __a, _Vec __b, _Vec __c, _Vec __d) noexcept {
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(__a, __b), _mm256_cmpeq_epi8(__c, __d))));
+    }
+
+    _LIBPENGCXX_TARGET_AVX2 static _Vec _S_shuffle(_Vec __table, _Vec __idx) noexcept {
+        return _mm256_shuffle_epi8(__table, __idx);
+    }
+
+    _LIBPENGCXX_TARGET_AVX2 static _Vec _S_and(_Vec __a, _Vec __b) noexcept {
+        return _mm256_and_si256(__a, __b);
+    }
+
+    _LIBPENGCXX_TARGET_AVX2 static _Vec _S_or(_Vec __a, _Vec __b) noexcept {
+        return _mm256_or_si256(__a, __b);
+    }
+
+    _LIBPENGCXX_TARGET_AVX2 static _Vec _S_xor(_Vec __a, _Vec __b) noexcept {
+        return _mm256_xor_si256(__a, __b);
+    }
+
+    _LIBPENGCXX_TARGET_AVX2 static _Vec _S_high_nibble(_Vec __a) noexcept {
+        return _mm256_and_si256(_mm256_srli_epi16(__a, 4), _mm256_set1_epi8(0x0f));
+    }
+};
+#endif
+
+inline unsigned _S_str_highest_bit(std::uint32_t __mask) noexcept {
+    return 31 - static_cast<unsigned>(std::countl_zero(__mask));
+}
+
+// 下面的算法模板以 _Simd = void 实例化时只有标量循环
+// 它们总是内联进带 target 属性的入口函数里，向量操作因此按入口函数的指令集编译
+// 模板本身没有 target 属性，GCC 会对其中的 256 位向量值给出 ABI 警告，但这些模板从不以非内联的形式被调用
+#if _LIBPENGCXX_STRING_DISPATCH && defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+template <class _Simd>
+_LIBPENGCXX_STRING_KERNEL inline std::size_t _S_str_find_char_impl(char const *__s, std::size_t __n, char __c) noexcept {
+    std::size_t __i = 0;
+    if constexpr (!std::is_void_v<_Simd>) {
+        // 一整个向量的字节同时与 __c 比较，movemask 把比较结果压成一个整数，最低的 1 位就是第一个匹配
+        // 每轮处理 64 字节，把几个向量的掩码拼成一个 64 位整数，减少分支
+        auto const __vc = _Simd::_S_splat(__c);
+        for (; __i + 64 <= __n; __i += 64) {
+            std::uint64_t __mask = 0;
+            for (std::size_t __k = 0; __k < 64; __k += _Simd::_S_width)
+                __mask |= std::uint64_t(_Simd::_S_eq_mask(_Simd::_S_load(__s + __i + __k), __vc)) << __k;
+            if (__mask != 0)
+                return __i + static_cast<std::size_t>(std::countr_zero(__mask));
+        }
+        for (; __i + _Simd::_S_width <= __n; __i += _Simd::_S_width) {
+            std::uint32_t __mask = _Simd::_S_eq_mask(_Simd::_S_load(__s + __i), __vc);
+            if (__mask != 0)
+                return __i + static_cast<std::size_t>(std::countr_zero(__mask));
+        }
+    }
+    for (; __i < __n; ++__i) {
+        if (__s[__i] == __c)
+            return __i;
+    }
+    return _S_str_npos;
+}
+
+template <class _Simd>
+_LIBPENGCXX_STRING_KERNEL inline std::size_t _S_str_rfind_char_impl(char const *__s, std::size_t __n, char __c) noexcept {
+    std::size_t __i = __n;
+    if constexpr (!std::is_void_v<_Simd>) {
+        auto const __vc = _Simd::_S_splat(__c);
+        while (__i >= _Simd::_S_width) {
+            __i -= _Simd::_S_width;
+            std::uint32_t __mask = _Simd::_S_eq_mask(_Simd::_S_load(__s + __i), __vc);
+            if (__mask != 0)
+                return __i + _S_str_highest_bit(__mask);
+        }
+    }
+    while (__i != 0) {
+        --__i;
+        if (__s[__i] == __c)
+            return __i;
+    }
+    return _S_str_npos;
+}
+
+// 子串查找：先用 SIMD 同时比较“首字符”和“尾字符”两个位置筛出候选，再用 memcmp 确认中间部分
+// 对于自然文本，首尾都相同的候选极少，绝大部分数据只经过两次向量比较
+template <class _Simd>
+_LIBPENGCXX_STRING_KERNEL inline std::size_t _S_str_find_impl(char const *__s, std::size_t __n,
+                                                              char const *__needle, std::size_t __m) noexcept {
+    if (__m == 0)
+        return 0;
+    if (__m > __n)
+        return _S_str_npos;
+    if (__m == 1)
+        return _S_str_find_char_impl<_Simd>(__s, __n, __needle[0]);
+    char const __first = __needle[0];
+    char const __last = __needle[__m - 1];
+    std::size_t const __cands = __n - __m + 1; // 可能的起始位置个数
+    std::size_t __i = 0;
+    if constexpr (!std::is_void_v<_Simd>) {
+        auto const __vfirst = _Simd::_S_splat(__first);
+        auto const __vlast = _Simd::_S_splat(__last);
+        for (; __i + _Simd::_S_width <= __cands; __i += _Simd::_S_width) {
+            std::uint32_t __mask = _Simd::_S_eq2_mask(
+                _Simd::_S_load(__s + __i), __vfirst,
+                _Simd::_S_load(__s + __i + __m - 1), __vlast);
+            while (__mask != 0) {
+                std::size_t __j = __i + static_cast<std::size_t>(std::countr_zero(__mask));
+                if (std::memcmp(__s + __j + 1, __needle + 1, __m - 2) == 0)
+                    return __j;
+                __mask &= __mask - 1;
+            }
+        }
+    }
+    for (; __i < __cands; ++__i) {
+        if (__s[__i] == __first && __s[__i + __m - 1] == __last &&
+            std::memcmp(__s + __i + 1, __needle + 1, __m - 2) == 0)
+            return __i;
+    }
+    return _S_str_npos;
+}
+
+template <class _Simd>
+_LIBPENGCXX_STRING_KERNEL inline std::size_t _S_str_rfind_impl(char const *__s, std::size_t __n,
+                                                               char const *__needle, std::size_t __m) noexcept {
+    if (__m > __n)
+        return _S_str_npos;
+    if (__m == 0)
+        return __n;
+    if (__m == 1)
+        return _S_str_rfind_char_impl<_Simd>(__s, __n, __needle[0]);
+    char const __first = __needle[0];
+    char const __last = __needle[__m - 1];
+    std::size_t __i = __n - __m + 1;
+    if constexpr (!std::is_void_v<_Simd>) {
+        auto const __vfirst = _Simd::_S_splat(__first);
+        auto const __vlast = _Simd::_S_splat(__last);
+        while (__i >= _Simd::_S_width) {
+            __i -= _Simd::_S_width;
+            std::uint32_t __mask = _Simd::_S_eq2_mask(
+                _Simd::_S_load(__s + __i), __vfirst,
+                _Simd::_S_load(__s + __i + __m - 1), __vlast);
+            while (__mask != 0) { // 从最高位开始确认，保证返回最后一个匹配
+                unsigned __bit = _S_str_highest_bit(__mask);
+                if (std::memcmp(__s + __i + __bit + 1, __needle + 1, __m - 2) == 0)
+                    return __i + __bit;
+                __mask &= ~(std::uint32_t(1) << __bit);
+            }
+        }
+    }
+    while (__i != 0) {
+        --__i;
+        if (__s[__i] == __first && __s[__i + __m - 1] == __last &&
+            std::memcmp(__s + __i + 1, __needle + 1, __m - 2) == 0)
+            return __i;
+    }
+    return _S_str_npos;
+}
+
+// find_first_of 等函数使用的字符集合
+// 标量路径查 256 位的位图；有 shuffle 指令时用“半字节查表”：
+// 低 4 位经 shuffle 查表得到一行，高 4 位经 shuffle 得到该行中的一个比特，二者相与即为是否命中
+struct _StrByteSet {
+    unsigned char _M_bitmap[32];
+    unsigned char _M_low_table[16];  // 高位为 0~7 的字节，按低 4 位索引，第 (高 4 位) 个比特表示存在
+    unsigned char _M_high_table[16]; // 高位为 8~15 的字节，同上
+
+    _StrByteSet(char const *__set, std::size_t __k) noexcept {
+        std::memset(this, 0, sizeof(_StrByteSet));
+        for (std::size_t __i = 0; __i < __k; ++__i) {
+            unsigned char __u = static_cast<unsigned char>(__set[__i]);
+            _M_bitmap[__u >> 3] |= static_cast<unsigned char>(1u << (__u & 7));
+            unsigned char *__table = __u < 0x80 ? _M_low_table : _M_high_table;
+            __table[__u & 0x0f] |= static_cast<unsigned char>(1u << ((__u >> 4) & 7));
+        }
+    }
+
+    bool _M_contains(char __c) const noexcept {
+        unsigned char __u = static_cast<unsigned char>(__c);
+        return (_M_bitmap[__u >> 3] >> (__u & 7)) & 1;
+    }
+
+    template <class _Simd>
+    struct _Tables {
+        typename _Simd::_Vec _M_low, _M_high, _M_bits;
+    };
+
+    template <class _Simd>
+    _LIBPENGCXX_STRING_KERNEL _Tables<_Simd> _M_load_tables() const noexcept {
+        static constexpr unsigned char __bits[16] = {
+            1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128,
+        };
+        return {_Simd::_S_load_table(_M_low_table),
+                _Simd::_S_load_table(_M_high_table),
+                _Simd::_S_load_table(__bits)};
+    }
+
+    template <class _Simd>
+    _LIBPENGCXX_STRING_KERNEL static std::uint32_t _S_match_mask(_Tables<_Simd> const &__t, char const *__p) noexcept {
+        auto __x = _Simd::_S_load(__p);
+        // shuffle 的索引最高位为 1 时结果为 0，所以两张表各自只会对属于自己的那一半字节生效
+        auto __row = _Simd::_S_or(
+            _Simd::_S_shuffle(__t._M_low, __x),
+            _Simd::_S_shuffle(__t._M_high, _Simd::_S_xor(__x, _Simd::_S_splat(char(0x80)))));
+        auto __bit = _Simd::_S_shuffle(__t._M_bits, _Simd::_S_high_nibble(__x));
+        return _Simd::_S_eq_mask(_Simd::_S_and(__row, __bit), __bit);
+    }
+};
+
+// 没有 shuffle 指令的 _Simd（SSE2）在这里退化为标量位图
+template <class _Simd>
+inline constexpr bool _S_str_has_shuffle = [] {
+    if constexpr (std::is_void_v<_Simd>)
+        return false;
+    else
+        return _Simd::_S_has_shuffle;
+}();
+
+template <class _Simd, bool _Not>
+_LIBPENGCXX_STRING_KERNEL inline std::size_t _S_str_find_set_impl(char const *__s, std::size_t __n,
+                                                                  char const *__set, std::size_t __k) noexcept {
+    if (!_Not && __k == 1)
+        return _S_str_find_char_impl<_Simd>(__s, __n, __set[0]);
+    _StrByteSet const __bs(__set, __k);
+    std::size_t __i = 0;
+    if constexpr (_S_str_has_shuffle<_Simd>) {
+        auto const __tables = __bs._M_load_tables<_Simd>();
+        for (; __i + _Simd::_S_width <= __n; __i += _Simd::_S_width) {
+            std::uint32_t __mask = _StrByteSet::_S_match_mask<_Simd>(__tables, __s + __i);
+            if (_Not)
+                __mask ^= _Simd::_S_full_mask;
+            if (__mask != 0)
+                return __i + static_cast<std::size_t>(std::countr_zero(__mask));
+        }
+    }
+    for (; __i < __n; ++__i) {
+        if (__bs._M_contains(__s[__i]) != _Not)
+            return __i;
+    }
+    return _S_str_npos;
+}
+
+template <class _Simd, bool _Not>
+_LIBPENGCXX_STRING_KERNEL inline std::size_t _S_str_rfind_set_impl(char const *__s, std::size_t __n,
+                                                                   char const *__set, std::size_t __k) noexcept {
+    if (!_Not && __k == 1)
+        return _S_str_rfind_char_impl<_Simd>(__s, __n, __set[0]);
+    _StrByteSet const __bs(__set, __k);
+    std::size_t __i = __n;
+    if constexpr (_S_str_has_shuffle<_Simd>) {
+        auto const __tables = __bs._M_load_tables<_Simd>();
+        while (__i >= _Simd::_S_width) {
+            __i -= _Simd::_S_width;
+            std::uint32_t __mask = _StrByteSet::_S_match_mask<_Simd>(__tables, __s + __i);
+            if (_Not)
+                __mask ^= _Simd::_S_full_mask;
+            if (__mask != 0)
+                return __i + _S_str_highest_bit(__mask);
+        }
+    }
+    while (__i != 0) {
+        --__i;
+        if (__bs._M_contains(__s[__i]) != _Not)
+            return __i;
+    }
+    return _S_str_npos;
+}
+
+#if _LIBPENGCXX_STRING_DISPATCH && defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// 一种指令集下的全部入口函数
+struct _StrSearchOps {
+    std::size_t (*_M_find_char)(char const *, std::size_t, char) noexcept;
+    std::size_t (*_M_rfind_char)(char const *, std::size_t, char) noexcept;
+    std::size_t (*_M_find)(char const *, std::size_t, char const *, std::size_t) noexcept;
+    std::size_t (*_M_rfind)(char const *, std::size_t, char const *, std::size_t) noexcept;
+    std::size_t (*_M_find_set[2])(char const *, std::size_t, char const *, std::size_t) noexcept; // 下标为 _Not
+    std::size_t (*_M_rfind_set[2])(char const *, std::size_t, char const *, std::size_t) noexcept;
+};
+
+// 为 _Simd 生成一组入口函数，_Simd 的向量操作在入口函数内联展开
+// 带 target 属性的入口函数不能是模板参数决定的，所以每种指令集各写一个外层结构
+#define _LIBPENGCXX_STRING_OPS(_Name, _Simd, _Target) \
+struct _Name { \
+    _Target static std::size_t _S_find_char(char const *__s, std::size_t __n, char __c) noexcept { \
+        return _S_str_find_char_impl<_Simd>(__s, __n, __c); \
+    } \
+    _Target static std::size_t _S_rfind_char(char const *__s, std::size_t __n, char __c) noexcept { \
+        return _S_str_rfind_char_impl<_Simd>(__s, __n, __c); \
+    } \
+    _Target static std::size_t _S_find(char const *__s, std::size_t __n, char const *__p, std::size_t __m) noexcept { \
+        return _S_str_find_impl<_Simd>(__s, __n, __p, __m); \
+    } \
+    _Target static std::size_t _S_rfind(char const *__s, std::size_t __n, char const *__p, std::size_t __m) noexcept { \
+        return _S_str_rfind_impl<_Simd>(__s, __n, __p, __m); \
+    } \
+    template <bool _Not> \
+    _Target static std::size_t _S_find_set(char const *__s, std::size_t __n, char const *__p, std::size_t __k) noexcept { \
+        return _S_str_find_set_impl<_Simd, _Not>(__s, __n, __p, __k); \
+    } \
+    template <bool _Not> \
+    _Target static std::size_t _S_rfind_set(char const *__s, std::size_t __n, char const *__p, std::size_t __k) noexcept { \
+        return _S_str_rfind_set_impl<_Simd, _Not>(__s, __n, __p, __k); \
+    } \
+    static constexpr _StrSearchOps _S_ops = { \
+        &_S_find_char, &_S_rfind_char, &_S_find, &_S_rfind, \
+        {&_S_find_set<false>, &_S_find_set<true>}, {&_S_rfind_set<false>, &_S_rfind_set<true>}, \
+    }; \
+};
+
+#if _LIBPENGCXX_STRING_SIMD
+_LIBPENGCXX_STRING_OPS(_StrSearchSse2, _StrSse2, )
+#else
+_LIBPENGCXX_STRING_OPS(_StrSearchScalar, void, )
+#endif
+#if _LIBPENGCXX_STRING_DISPATCH
+_LIBPENGCXX_STRING_OPS(_StrSearchSsse3, _StrSsse3, _LIBPENGCXX_TARGET_SSSE3)
+_LIBPENGCXX_STRING_OPS(_StrSearchAvx2, _StrAvx2, _LIBPENGCXX_TARGET_AVX2)
+#endif
+
+#undef _LIBPENGCXX_STRING_OPS
+
+inline _StrSearchOps const &_S_str_ops() noexcept {
+    static _StrSearchOps const &__ops = [] () -> _StrSearchOps const & {
+#if _LIBPENGCXX_STRING_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return _StrSearchAvx2::_S_ops;
+        if (__builtin_cpu_supports("ssse3"))
+            return _StrSearchSsse3::_S_ops;
+#endif
+#if _LIBPENGCXX_STRING_SIMD
+        return _StrSearchSse2::_S_ops;
+#else
+        return _StrSearchScalar::_S_ops;
+#endif
+    }();
+    return __ops;
+}
+
+inline std::size_t _S_str_find_char(char const *__s, std::size_t __n, char __c) noexcept {
+    return _S_str_ops()._M_find_char(__s, __n, __c);
+}
+
+inline std::size_t _S_str_rfind_char(char const *__s, std::size_t __n, char __c) noexcept {
+    return _S_str_ops()._M_rfind_char(__s, __n, __c);
+}
+
+inline std::size_t _S_str_find(char const *__s, std::size_t __n,
+                               char const *__needle, std::size_t __m) noexcept {
+    return _S_str_ops()._M_find(__s, __n, __needle, __m);
+}
+
+inline std::size_t _S_str_rfind(char const *__s, std::size_t __n,
+                                char const *__needle, std::size_t __m) noexcept {
+    return _S_str_ops()._M_rfind(__s, __n, __needle, __m);
+}
+
+template <bool _Not>
+inline std::size_t _S_str_find_set(char const *__s, std::size_t __n,
+                                   char const *__set, std::size_t __k) noexcept {
+    return _S_str_ops()._M_find_set[_Not](__s, __n, __set, __k);
+}
+
+template <bool _Not>
+inline std::size_t _S_str_rfind_set(char const *__s, std::size_t __n,
+                                    char const *__set, std::size_t __k) noexcept {
+    return _S_str_ops()._M_rfind_set[_Not](__s, __n, __set, __k);
+}
@@ -0,0 +1,91 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <sstream>
+#include "Charconv.hpp"
+
+template <class T>
+static void check_int(T value) {
+    char ours[32], ref[32];
+    auto r1 = toChars(ours, ours + sizeof(ours), value);
+    auto r2 = std::to_chars(ref, ref + sizeof(ref), value);
+    assert(r1.ec == std::errc() && std::string_view(ours, r1.ptr) == std::string_view(ref, r2.ptr));
+    T back = 0;
+    auto r3 = fromChars(ours, r1.ptr, back);
+    assert(r3.ec == std::errc() && r3.ptr == r1.ptr && back == value);
+}
+
+// 只接受 64 位以内的整数，__int128 与字符类型不参与重载
+template <class T>
+constexpr bool has_to_chars = requires (char *p, T v) { toChars(p, p, v); };
+
+static_assert(has_to_chars<long long> && has_to_chars<unsigned char> && has_to_chars<double>);
+static_assert(!has_to_chars<__int128> && !has_to_chars<unsigned __int128>);
+static_assert(!has_to_chars<char> && !has_to_chars<wchar_t> && !has_to_chars<char8_t> && !has_to_chars<char32_t>);
+
+int main() {
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 100000; i++) {
+        std::uint64_t bits = rng() >> (rng() % 64);
+        check_int(bits);
+        check_int(std::int64_t(bits));
+        check_int(std::int32_t(bits));
+        check_int(std::uint16_t(bits));
+        check_int(std::int8_t(bits));
+    }
+    check_int(std::numeric_limits<std::int64_t>::min());
+    check_int(std::numeric_limits<std::uint64_t>::max());
+    check_int(0);
+
+    int v = 0;
+    assert(fromChars("2147483648", v).ec == std::errc::result_out_of_range);
+    assert(fromChars("-2147483648", v).ec == std::errc() && v == std::numeric_limits<int>::min());
+    assert(fromChars("x1", v).ec == std::errc::invalid_argument);
+
+    for (int i = 0; i < 100000; i++) {
+        std::uint64_t bits = rng();
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        if (d != d)
+            continue;
+        String s = toString(d);
+        double back;
+        assert(fromChars(s, back).ec == std::errc() && back == d); // 最短表示也能精确还原
+    }
+
+    String json = "{\"id\":";
+    appendNumber(json, 42);
+    json += ",\"score\":";
+    appendNumber(json, 0.1);
+    json += ",\"delta\":";
+    appendNumber(json, -1e-300);
+    json += "}";
+    printf("%s\n", json.c_str());
+    assert(json == "{\"id\":42,\"score\":0.1,\"delta\":-1e-300}");
+
+    // 与 iostream 格式化对比
+    int const n = 1000000;
+    auto t0 = std::chrono::steady_clock::now();
+    String out;
+    for (int i = 0; i < n; i++) {
+        appendNumber(out, i * 7919ll);
+        out += ',';
+        appendNumber(out, i * 0.001);
+        out += ',';
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::ostringstream oss;
+    oss.precision(17);
+    for (int i = 0; i < n; i++)
+        oss << i * 7919ll << ',' << i * 0.001 << ',';
+    auto t2 = std::chrono::steady_clock::now();
+    printf("appendNumber: %.1f ms, ostringstream: %.1f ms\n",
+           std::chrono::duration<double, std::milli>(t1 - t0).count(),
+           std::chrono::duration<double, std::milli>(t2 - t1).count());
+    return 0;
+}
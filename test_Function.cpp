@@ -1,6 +1,31 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <new>
 #include "Functional.hpp"
+#include "UniquePtr.hpp"
+#include "Vector.hpp"
+
+static int g_allocs = 0; // 统计堆分配次数
+
+// 不内联：否则 GCC 看到 operator new 分配的内存被 free 释放，会误报 -Wmismatched-new-delete
+__attribute__((noinline)) void *operator new(std::size_t n) {
+    ++g_allocs;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
 
 void func_hello(int i) {
     printf("#%d Hello\n", i);
@@ -19,6 +44,21 @@ void repeattwice(Function<void(int)> const &func) {
     func(2);
 }
 
+int sum_each(int n, FunctionRef<int(int)> f) {
+    int s = 0;
+    for (int i = 0; i < n; i++)
+        s += f(i);
+    return s;
+}
+
+int square(int i) {
+    return i * i;
+}
+
+static int twice(int i) { // 内部链接的函数，GCC 知道它的地址不可能为空
+    return i * 2;
+}
+
 int main() {
     int x = 4;
     int y = 2;
@@ -37,5 +77,110 @@ int main() {
     auto ff = f;
     ff(3);
 
+    // 不超过 3 个指针的仿函数：构造、拷贝、移动、调用都不分配内存
+    int allocs = g_allocs;
+    {
+        void *a = &x, *b = &y, *c = nullptr;
+        Function<int(int)> small([a, b, c] (int i) { return i + (a != b) + (c == nullptr); });
+        Function<int(int)> copy = small;
+        Function<int(int)> moved = std::move(small);
+        assert(!small && copy(1) == 3 && moved(2) == 4);
+        copy.swap(moved);
+        assert(copy(0) == 2);
+        MoveOnlyFunction<int()> task([p = &x] { return *p; });
+        MoveOnlyFunction<int()> task2 = std::move(task);
+        assert(task2() == 4);
+    }
+    assert(g_allocs == allocs);
+
+    // 按操作表判断仿函数类型，-fno-rtti 下也能用 target
+    Function<void(int)> hello = func_hello;
+    assert(hello.target<void (*)(int)>() && *hello.target<void (*)(int)>() == func_hello);
+    assert(hello.target<func_printnum_t>() == nullptr);
+#if _LIBPENGCXX_HAS_RTTI
+    assert(hello.target_type() == typeid(void (*)(int)));
+    assert(Function<void(int)>().target_type() == typeid(void));
+#endif
+    Function<void()> discard([] { return 1; }); // 返回值被丢弃
+    discard();
+    printf("sizeof(Function) = %zd\n", sizeof(Function<void()>));
+
+    // 大的仿函数放在堆上，移动时只转移指针
+    {
+        char big[64] = {42};
+        Function<int()> large([big] { return int(big[0]); });
+        assert(g_allocs == allocs + 1);
+        Function<int()> moved = std::move(large);
+        assert(g_allocs == allocs + 1 && moved() == 42);
+        Function<int()> copy = moved;
+        assert(g_allocs == allocs + 2 && copy() == 42);
+        MoveOnlyFunction<int()> owner([p = std::make_unique<int>(7)] { return *p; });
+        assert(owner() == 7);
+    }
+
+    // FunctionRef 只引用仿函数，不分配内存
+    allocs = g_allocs;
+    int base = 10;
+    assert(sum_each(3, [&] (int i) { return base + i; }) == 33);
+    assert(sum_each(4, square) == 14);
+    Function<int(int)> boxed = [base] (int i) { return base * i; };
+    FunctionRef<int(int)> ref = boxed;
+    FunctionRef<int(int)> ref2 = ref;
+    assert(ref2(2) == 20 && sum_each(2, ref) == 10);
+    assert(g_allocs == allocs);
+    static_assert(std::is_trivially_copyable_v<FunctionRef<int(int)>>);
+    static_assert(sizeof(FunctionRef<int(int)>) == 2 * sizeof(void *));
+
+    // MoveOnlyFunction：const / noexcept / & / && 限定，只能移动的小仿函数内联存放
+    {
+        int p1 = 0;
+        auto up1 = makeUnique<int>(5);
+        auto up2 = makeUnique<int>(6);
+        allocs = g_allocs;
+        Vector<MoveOnlyFunction<void()>> tasks;
+        tasks.reserve(4);
+        int const after_reserve = g_allocs;
+        tasks.push_back([&p1, u = std::move(up1)] { p1 += *u; });
+        tasks.push_back([&p1, u = std::move(up2)] { p1 += *u; });
+        for (auto &t : tasks)
+            t();
+        assert(p1 == 11 && g_allocs == after_reserve);
+
+        MoveOnlyFunction<int() const> c([] { return 1; });
+        MoveOnlyFunction<int() noexcept> ne([] () noexcept { return 2; });
+        struct consume_t {
+            UniquePtr<int> u;
+            int operator()() && { return *u; }
+        };
+        MoveOnlyFunction<int() &&> once(consume_t{makeUnique<int>(3)});
+        static_assert(std::is_nothrow_invocable_v<MoveOnlyFunction<int() noexcept> &>);
+        static_assert(!std::is_invocable_v<MoveOnlyFunction<int() &&> &>);
+        static_assert(!std::is_constructible_v<MoveOnlyFunction<int() const>, decltype([i = 0] () mutable { return ++i; })>);
+        static_assert(!std::is_constructible_v<MoveOnlyFunction<int() noexcept>, int (*)()>);
+        assert(c() == 1 && ne() == 2 && std::move(once)() == 3);
+
+        // 直接用函数名构造：实参是函数引用，不能当作空指针比较
+        MoveOnlyFunction<int(int)> by_name(twice);
+        MoveOnlyFunction<int(int)> by_copy_init = square;
+        MoveOnlyFunction<int(int)> by_in_place(std::in_place_type<int (*)(int)>, twice);
+        assert(by_name(2) == 4 && by_copy_init(3) == 9 && by_in_place(4) == 8);
+
+        MoveOnlyFunction<int(int)> fp(static_cast<int (*)(int)>(nullptr));
+        assert(!fp);
+        fp = square;
+        assert(fp(3) == 9);
+        fp = nullptr;
+        assert(fp == nullptr);
+    }
+
+    Function<void()> empty;
+    bool thrown = false;
+    try {
+        empty();
+    } catch (std::bad_function_call const &) {
+        thrown = true;
+    }
+    assert(thrown);
+
     return 0;
 }
@@ -0,0 +1,99 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "Functional.hpp"
+#include "InplaceFunctionVector.hpp"
+#include "UniquePtr.hpp"
+#include "Vector.hpp"
+
+static int g_alive = 0; // 存活的 Tracked 对象数
+
+struct Tracked {
+    int *sum;
+    int v;
+    Tracked(int *s, int x) : sum(s), v(x) { ++g_alive; }
+    Tracked(Tracked &&that) noexcept : sum(that.sum), v(that.v) { ++g_alive; }
+    ~Tracked() { --g_alive; }
+    void operator()(int k) const { *sum += v * k; }
+};
+
+int main() {
+    {
+        int sum = 0;
+        InplaceFunctionVector<void(int)> hooks;
+        hooks.push_back([&sum] (int k) { sum += k; });
+        hooks.push_back([&sum, p = makeUnique<int>(100)] (int k) { sum += *p * k; }); // 只能移动的仿函数
+        char big[200] = {3};
+        hooks.push_back([&sum, big] (int k) { sum += big[0] * k; });
+        for (int i = 0; i < 100; i++) // 反复扩容，非平凡的仿函数要逐个移动
+            hooks.emplace_back<Tracked>(&sum, 1);
+        assert(hooks.size() == 103 && g_alive == 100);
+        hooks.invoke_all(2);
+        assert(sum == 2 + 200 + 6 + 200);
+
+        InplaceFunctionVector<void(int)> moved = std::move(hooks);
+        assert(hooks.empty() && moved.size() == 103);
+        sum = 0;
+        moved.invoke_all(1);
+        assert(sum == 1 + 100 + 3 + 100);
+        moved.clear();
+        assert(g_alive == 0 && moved.empty());
+        moved.invoke_all(1);
+        assert(sum == 1 + 100 + 3 + 100);
+    }
+    {
+        // 参数引用已有的仿函数：扩容时先构造新元素再搬移，引用不会失效
+        std::string text(100, 'x');
+        std::size_t total = 0;
+        InplaceFunctionVector<void()> copies;
+        auto *last = &copies.push_back([&total, text] { total += text.size(); });
+        for (int i = 0; i < 50; i++)
+            last = &copies.push_back(*last);
+        assert(copies.size() == 51);
+        copies.invoke_all();
+        assert(total == 51 * 100);
+    }
+
+    // 吞吐量：10 万个捕获不同数量变量的回调，对比 Vector<Function<void()>>
+    constexpr int n = 100000;
+    std::mt19937 rng(1);
+    long long acc = 0;
+    InplaceFunctionVector<void()> inplace;
+    Vector<Function<void()>> boxed;
+    for (int i = 0; i < n; i++) {
+        long long a = rng() % 7, b = rng() % 5, c = rng() % 3, d = rng() % 11;
+        switch (i % 3) {
+        case 0:
+            inplace.push_back([&acc, a] { acc += a; });
+            boxed.push_back([&acc, a] { acc += a; });
+            break;
+        case 1:
+            inplace.push_back([&acc, a, b] { acc += a * b; });
+            boxed.push_back([&acc, a, b] { acc += a * b; });
+            break;
+        default: // 超过 3 个指针，Function 需要放在堆上
+            inplace.push_back([&acc, a, b, c, d] { acc += a + b + c + d; });
+            boxed.push_back([&acc, a, b, c, d] { acc += a + b + c + d; });
+            break;
+        }
+    }
+    auto bench = [&] (auto &&fn) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < 50; r++)
+            fn();
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(t1 - t0).count() / 50 * 1e9 / n;
+    };
+    acc = 0;
+    double t_inplace = bench([&] { inplace.invoke_all(); });
+    long long acc_inplace = acc;
+    acc = 0;
+    double t_boxed = bench([&] { for (auto &f : boxed) f(); });
+    assert(acc == acc_inplace);
+    printf("%d callbacks, %zd bytes: InplaceFunctionVector %.2f ns/call, Vector<Function> %.2f ns/call\n",
+           n, inplace.bytes(), t_inplace, t_boxed);
+    return 0;
+}
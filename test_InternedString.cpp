@@ -0,0 +1,49 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "InternedString.hpp"
+#include "Map.hpp"
+
+int main() {
+    InternedString a("cpu.usage");
+    InternedString b(String("cpu.") + "usage");
+    InternedString c("mem.usage");
+    assert(a == b && a.data() == b.data()); // 同一份内容只存一份
+    assert(a != c && a < c);
+    assert(a.use_count() == 2);
+    assert(a.hash() == std::hash<std::string_view>()("cpu.usage"));
+    printf("sizeof(InternedString) = %zd\n", sizeof(InternedString));
+
+    Map<InternedString, int, InternedString::IdentityLess> counters;
+    counters[a] += 1;
+    counters[b] += 1;
+    counters[c] += 1;
+    for (auto const &[name, count] : counters)
+        std::cout << name << " = " << count << '\n';
+
+    // 多线程同时驻留相同的名字，都应得到同一个块
+    InternedString host("host.name");
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10000; i++) {
+                InternedString s("label." + std::to_string(i % 100));
+                InternedString k("host.name");
+                if (k != host || s.str() != "label." + std::to_string(i % 100))
+                    ++mismatches;
+            }
+        });
+    }
+    for (auto &th : threads)
+        th.join();
+    assert(mismatches == 0);
+    assert(host.use_count() == 1);
+    printf("all threads agree\n");
+    return 0;
+}
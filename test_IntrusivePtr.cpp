@@ -0,0 +1,120 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "IntrusivePtr.hpp"
+
+static int g_destroyed = 0;
+
+struct Shape : IntrusiveRefCounted<Shape> {
+    virtual int sides() const = 0;
+    virtual ~Shape() { ++g_destroyed; }
+};
+
+struct Square : Shape {
+    int sides() const override { return 4; }
+};
+
+struct Vertex : IntrusiveRefCounted<Vertex, _SpLocalPolicy> {
+    long value;
+    std::vector<IntrusivePtr<Vertex>> edges;
+
+    explicit Vertex(long v) : value(v) {}
+};
+
+struct SharedVertex {
+    long value;
+    std::vector<SharedPtr<SharedVertex>> edges;
+
+    explicit SharedVertex(long v) : value(v) {}
+};
+
+// 沿边遍历整张图，每一步都拷贝一次指针，模拟遍历时持有邻居的引用
+template <class Ptr>
+static long walk(Ptr p, long steps) {
+    long sum = 0;
+    for (long i = 0; i < steps; i++) {
+        sum += p->value;
+        Ptr next = p->edges[(i * 7 + p->value) % p->edges.size()];
+        p = next;
+    }
+    return sum;
+}
+
+template <class Ptr, class Make>
+static double bench_walk(Make make) {
+    long n = 4096, degree = 24;
+    std::vector<Ptr> nodes;
+    for (long i = 0; i < n; i++)
+        nodes.push_back(make(i));
+    for (long i = 0; i < n; i++)
+        for (long j = 0; j < degree; j++)
+            nodes[i]->edges.push_back(nodes[(i * 2654435761u + j * 40503) % n]);
+    long steps = 5000000;
+    auto t0 = std::chrono::steady_clock::now();
+    long sum = walk(nodes[0], steps);
+    auto t1 = std::chrono::steady_clock::now();
+    asm volatile("" : : "r"(sum));
+    for (auto &p : nodes)
+        p->edges.clear(); // 打破环，释放所有节点
+    return std::chrono::duration<double>(t1 - t0).count() * 1e9 / steps;
+}
+
+int main() {
+    static_assert(sizeof(IntrusivePtr<Vertex>) == sizeof(void *));
+    static_assert(sizeof(IntrusivePtr<Shape>) == sizeof(void *));
+
+    {
+        IntrusivePtr<Shape> s = makeIntrusive<Square>();
+        assert(s.use_count() == 1 && s->sides() == 4);
+        IntrusivePtr<Shape> t = s;
+        assert(s.use_count() == 2 && t == s);
+        // 同一个裸指针可以再次交给 IntrusivePtr
+        IntrusivePtr<Shape> u(s.get());
+        assert(s.use_count() == 3);
+        auto sq = staticPointerCast<Square>(u);
+        assert(sq.use_count() == 4);
+        Shape *raw = t.release();
+        assert(!t && s.use_count() == 4);
+        t.reset(raw, false);
+        assert(s.use_count() == 4);
+        s = s;
+        assert(t.use_count() == 4 && g_destroyed == 0);
+    }
+    assert(g_destroyed == 1);
+
+    {
+        // 多个线程同时拷贝、释放同一个对象
+        IntrusivePtr<Shape> s = makeIntrusive<Square>();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([s] {
+                for (int i = 0; i < 100000; i++) {
+                    IntrusivePtr<Shape> copy = s;
+                    assert(copy->sides() == 4);
+                }
+            });
+        }
+        for (auto &t : threads)
+            t.join();
+        assert(s.use_count() == 1);
+    }
+    assert(g_destroyed == 2);
+
+    {
+        // 复制对象不复制计数
+        auto v = makeIntrusive<Vertex>(1);
+        auto w = makeIntrusive<Vertex>(*v);
+        assert(v.use_count() == 1 && w.use_count() == 1);
+        v->edges.push_back(w);
+        v = std::move(v->edges[0]); // 替换掉唯一引用 v 自身，仍然安全
+        assert(v == w && w.use_count() == 2);
+    }
+
+    double t_intrusive = bench_walk<IntrusivePtr<Vertex>>([](long i) { return makeIntrusive<Vertex>(i); });
+    double t_shared = bench_walk<SharedPtr<SharedVertex>>([](long i) { return makeShared<SharedVertex>(i); });
+    printf("graph walk: IntrusivePtr %.2f ns/step, SharedPtr %.2f ns/step\n", t_intrusive, t_shared);
+    return 0;
+}
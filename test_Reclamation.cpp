@@ -0,0 +1,188 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "Reclamation.hpp"
+
+static std::atomic<long> g_alive{0};
+
+struct Node {
+    long value;
+    Node *next = nullptr;
+
+    explicit Node(long v) : value(v) { g_alive.fetch_add(1); }
+    ~Node() { value = -1; g_alive.fetch_sub(1); }
+};
+
+// Treiber 无锁栈：pop 摘下的节点交给回收域，而不是立即 delete
+struct EpochStack {
+    EpochDomain &domain;
+    std::atomic<Node *> head{nullptr};
+
+    void push(long v) {
+        Node *n = new Node(v);
+        n->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    bool pop(long &out) {
+        auto guard = domain.pin();
+        // 读取与摘下都用默认的 seq_cst，与回收域内的操作处在同一全序中
+        Node *n = head.load();
+        while (n && !head.compare_exchange_weak(n, n->next)) {}
+        if (!n)
+            return false;
+        out = n->value;
+        domain.retire(n);
+        return true;
+    }
+};
+
+struct HazardStack {
+    HazardDomain &domain;
+    std::atomic<Node *> head{nullptr};
+
+    void push(long v) {
+        Node *n = new Node(v);
+        n->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    bool pop(long &out) {
+        auto hp = domain.make_hazard();
+        for (;;) {
+            Node *n = hp.protect(head);
+            if (!n)
+                return false;
+            if (head.compare_exchange_strong(n, n->next)) {
+                out = n->value;
+                hp.reset();
+                domain.retire(n, [](Node *p) { delete p; });
+                return true;
+            }
+        }
+    }
+};
+
+// 多个线程同时 push/pop，每个值恰好被 pop 一次；回收错误会在 ASan/TSan 下表现为释放后使用
+template <class Stack>
+static double stress(Stack &stack, int threads, long per_thread) {
+    std::vector<std::thread> workers;
+    std::atomic<long> sum{0}, popped{0};
+    auto t0 = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            long local = 0, n = 0, v;
+            for (long i = 0; i < per_thread; i++) {
+                stack.push(t * per_thread + i + 1);
+                if (stack.pop(v)) {
+                    local += v;
+                    n++;
+                }
+            }
+            sum.fetch_add(local);
+            popped.fetch_add(n);
+        });
+    }
+    for (auto &w : workers)
+        w.join();
+    auto t1 = std::chrono::steady_clock::now();
+    long v;
+    while (stack.pop(v)) {
+        sum.fetch_add(v);
+        popped.fetch_add(1);
+    }
+    long total = threads * per_thread;
+    assert(popped.load() == total);
+    assert(sum.load() == total * (total + 1) / 2);
+    return std::chrono::duration<double>(t1 - t0).count() * 1e9 / total;
+}
+
+int main() {
+    {
+        // 被 pin 住的线程阻止回收，退出临界区后才能回收
+        EpochDomain domain;
+        Node *n = new Node(1);
+        std::atomic<int> stage{0};
+        std::thread reader([&] {
+            auto guard = domain.pin();
+            stage = 1;
+            while (stage.load() != 2) {}
+        });
+        while (stage.load() != 1) {}
+        domain.retire(n);
+        for (int i = 0; i < 5; i++)
+            domain.collect();
+        assert(g_alive.load() == 1);
+        stage = 2;
+        reader.join();
+        for (int i = 0; i < 3; i++)
+            domain.collect();
+        assert(g_alive.load() == 0);
+
+        // 嵌套 pin
+        auto g1 = domain.pin();
+        {
+            auto g2 = domain.pin();
+        }
+        std::uint64_t e = domain.epoch();
+        domain.collect();
+        domain.collect();
+        assert(domain.epoch() <= e + 1); // 本线程仍在临界区内，纪元最多前进一步
+    }
+    {
+        // 被风险指针保护的对象不会被回收
+        HazardDomain domain;
+        std::atomic<Node *> src{new Node(2)};
+        auto hp = domain.make_hazard();
+        Node *p = hp.protect(src);
+        src.store(nullptr);
+        domain.retire(p);
+        domain.collect();
+        assert(g_alive.load() == 1 && p->value == 2);
+        hp.reset();
+        domain.collect();
+        assert(g_alive.load() == 0);
+
+        std::vector<HazardDomain::HazardPointer> many;
+        for (std::size_t i = 1; i < HazardDomain::slots_per_thread; i++)
+            many.push_back(domain.make_hazard());
+        try {
+            auto extra = domain.make_hazard();
+            assert(false);
+        } catch (std::length_error const &) {
+        }
+        many.pop_back();
+        auto again = domain.make_hazard();
+    }
+    {
+        // 域销毁时回收剩余对象，包括已退出线程留下的
+        EpochDomain domain;
+        std::thread([&] {
+            for (int i = 0; i < 10; i++)
+                domain.retire(new Node(i));
+        }).join();
+        auto guard = domain.pin();
+        domain.retire(new Node(0));
+        assert(g_alive.load() == 11);
+    }
+    assert(g_alive.load() == 0);
+
+    double t_epoch, t_hazard;
+    {
+        EpochDomain domain;
+        EpochStack stack{domain};
+        t_epoch = stress(stack, 4, 200000);
+    }
+    assert(g_alive.load() == 0);
+    {
+        HazardDomain domain;
+        HazardStack stack{domain};
+        t_hazard = stress(stack, 4, 200000);
+    }
+    assert(g_alive.load() == 0);
+    printf("treiber stack push+pop: EpochDomain %.2f ns, HazardDomain %.2f ns\n", t_epoch, t_hazard);
+    return 0;
+}
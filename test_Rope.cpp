@@ -0,0 +1,54 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include "Rope.hpp"
+
+int main() {
+    Rope page("<html><body></body></html>");
+    Rope item("<li>item</li>");
+    page.insert(12, "<ul></ul>");
+    for (int i = 0; i < 3; i++)
+        page.insert(16, item); // 同一个 item 被共享，不会复制
+    std::cout << page << '\n';
+    assert(page == "<html><body><ul><li>item</li><li>item</li><li>item</li></ul></body></html>");
+
+    // 随机插入删除，与 std::string 对比
+    std::mt19937 rng(1);
+    std::string ref;
+    Rope rope;
+    for (int round = 0; round < 20000; round++) {
+        std::size_t pos = rng() % (ref.size() + 1);
+        if (rng() % 3 != 0 || ref.empty()) {
+            std::string piece(1 + rng() % (rng() % 50 == 0 ? 5000 : 20), char('a' + rng() % 26));
+            ref.insert(pos, piece);
+            rope.insert(pos, piece);
+        } else {
+            std::size_t n = rng() % 100;
+            ref.erase(pos, n);
+            rope.erase(pos, n);
+        }
+    }
+    assert(rope.size() == ref.size());
+    assert(rope == ref);
+    assert(rope.str() == ref);
+    assert(rope.substr(1000, 5000) == ref.substr(1000, 5000));
+    for (std::size_t i = 0; i < ref.size(); i += 997)
+        assert(rope[i] == ref[i]);
+    std::size_t chunks = 0;
+    for (std::string_view chunk : rope.chunks())
+        chunks += !chunk.empty();
+    printf("size = %zu, chunks = %zu, height = %u\n", rope.size(), chunks, rope.height());
+    assert(rope.height() <= 1.45 * std::log2(chunks + 2)); // AVL 树的高度上界
+
+    // O(1) 拼接：把一个 1 MB 的 Rope 与自身拼接 10 次，得到 1 GB 的文本，但只占 1 MB 内存
+    Rope big(std::string(1 << 20, 'x'));
+    for (int i = 0; i < 10; i++)
+        big += big;
+    printf("big.size() = %zu, height = %u\n", big.size(), big.height());
+    assert(big.size() == std::size_t(1) << 30);
+    return 0;
+}
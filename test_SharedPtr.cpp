@@ -1,5 +1,12 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
 #include "SharedPtr.hpp"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 // CRTP
 struct Student : EnableSharedFromThis<Student> {
@@ -31,7 +38,587 @@ struct StudentDerived : Student {
     }
 };
 
+struct Node : EnableSharedFromThis<Node, _SpLocalPolicy> {
+    int value;
+    LocalSharedPtr<Node> next;
+
+    explicit Node(int v) : value(v) {}
+
+    LocalSharedPtr<Node> self() {
+        return shared_from_this();
+    }
+};
+
+static int g_destroyed = 0;
+
+struct Counted {
+    ~Counted() { ++g_destroyed; }
+};
+
+template <class Ptr>
+static double bench_copies(Ptr const &p) {
+    std::vector<Ptr> v(64);
+    long n = 5000000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++) {
+        v[i & 63] = p;
+        asm volatile("" : : "r"(v.data()) : "memory");
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count() * 1e9 / n;
+}
+
+static void test_local() {
+    // 单线程引用计数：与 makeShared 一样一次分配，行为与 SharedPtr 一致
+    {
+        LocalSharedPtr<Counted> a = makeLocalShared<Counted>();
+        LocalSharedPtr<Counted> b = a;
+        assert(a.use_count() == 2);
+        b.reset();
+        assert(a.use_count() == 1 && g_destroyed == 0);
+    }
+    assert(g_destroyed == 1);
+    {
+        LocalSharedPtr<Counted> a(new Counted);
+        LocalSharedPtr<Counted> b(new Counted, [] (Counted *p) { delete p; });
+        b = a;
+        assert(g_destroyed == 2 && a.use_count() == 2);
+    }
+    assert(g_destroyed == 3);
+
+    auto head = makeLocalShared<Node>(1);
+    head->next = makeLocalShared<Node>(2);
+    LocalSharedPtr<Node> self = head->next->self();
+    assert(self.use_count() == 2 && self->value == 2);
+    static_assert(!std::is_constructible_v<SharedPtr<Node>, LocalSharedPtr<Node>>);
+
+    auto sp = makeShared<int>(1);
+    auto lp = makeLocalShared<int>(1);
+    double t_atomic = bench_copies(sp);
+    double t_local = bench_copies(lp);
+    printf("copy-assign: SharedPtr %.2f ns, LocalSharedPtr %.2f ns\n", t_atomic, t_local);
+}
+
+static void test_weak() {
+    // 一次分配的对象在强引用归零时立即析构，内存等弱引用也归零后才释放
+    g_destroyed = 0;
+    WeakPtr<Counted> w;
+    {
+        SharedPtr<Counted> p = makeShared<Counted>();
+        w = p;
+        assert(w.use_count() == 1 && !w.expired());
+        SharedPtr<Counted> q = w.lock();
+        assert(q == p && p.use_count() == 2);
+    }
+    assert(g_destroyed == 1 && w.expired() && !w.lock());
+    try {
+        SharedPtr<Counted> r(w);
+        assert(false);
+    } catch (std::bad_weak_ptr const &) {
+    }
+    w.reset();
+
+    // 单独分配的控制块同理
+    LocalWeakPtr<Counted> lw;
+    {
+        LocalSharedPtr<Counted> p(new Counted);
+        lw = p;
+        LocalWeakPtr<Counted> lw2 = lw;
+        assert(lw2.lock().use_count() == 2);
+    }
+    assert(g_destroyed == 2 && lw.expired());
+
+    // shared_from_this 不再延长对象的生命周期，析构后也不再能取得 SharedPtr
+    LocalWeakPtr<Node> wn;
+    {
+        auto n = makeLocalShared<Node>(5);
+        wn = n->self();
+        assert(wn.use_count() == 1);
+    }
+    assert(wn.expired());
+
+    // 多个线程同时 lock 与释放最后一个强引用：lock 要么成功拿到存活的对象，要么得到空指针
+    for (int round = 0; round < 2000; round++) {
+        auto p = makeShared<int>(round);
+        WeakPtr<int> wp = p;
+        std::atomic<int> go{0};
+        std::thread t([&] {
+            while (!go.load()) {}
+            for (int i = 0; i < 50; i++) {
+                if (auto q = wp.lock())
+                    assert(*q == round);
+            }
+        });
+        go = 1;
+        p.reset();
+        t.join();
+        assert(wp.expired());
+    }
+}
+
+// 发布订阅扇出：每个线程负责一部分订阅者，把同一条消息分发给它们再丢弃
+template <bool Batched>
+static double bench_fanout(int threads, int subscribers, int messages) {
+    std::vector<std::thread> workers;
+    auto t0 = std::chrono::steady_clock::now();
+    std::atomic<int> ready{0};
+    std::vector<SharedPtr<Counted>> msgs;
+    for (int m = 0; m < messages; m++)
+        msgs.push_back(makeShared<Counted>());
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            std::vector<SharedPtr<Counted>> inbox(subscribers / threads);
+            ready.fetch_add(1);
+            while (ready.load() != threads) {}
+            for (auto const &msg : msgs) {
+                if constexpr (Batched) {
+                    auto batch = msg.share_n(inbox.size());
+                    for (auto &slot : inbox)
+                        slot = batch.take();
+                    for (auto &slot : inbox)
+                        deferRelease(std::move(slot));
+                    flushDeferredReleases();
+                } else {
+                    for (auto &slot : inbox)
+                        slot = msg;
+                    for (auto &slot : inbox)
+                        slot.reset();
+                }
+            }
+        });
+    }
+    for (auto &w : workers)
+        w.join();
+    msgs.clear();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count() * 1e9 / ((double)messages * subscribers);
+}
+
+static void test_batch() {
+    g_destroyed = 0;
+    {
+        auto p = makeShared<Counted>();
+        {
+            auto batch = p.share_n(5);
+            assert(batch.size() == 5 && p.use_count() == 6);
+            SharedPtr<Counted> a = batch.take(), b = batch.take();
+            assert(a == p && p.use_count() == 6 && batch.size() == 3);
+            auto moved = std::move(batch);
+            assert(batch.empty() && moved.size() == 3);
+        }
+        assert(p.use_count() == 1); // 没取走的引用一次还回去
+        assert(!SharedPtr<Counted>().share_n(3).take());
+        {
+            // 强引用恰好到达 2^32 - 1 的上限，不会进位到弱引用
+            WeakPtr<Counted> weak = p;
+            auto batch = p.share_n(0xfffffffe);
+            assert(p.use_count() == 0xffffffffL && !weak.expired());
+        }
+        assert(p.use_count() == 1 && g_destroyed == 0);
+
+        // 延迟释放：合并到 flush 时再减，最后一个引用也可以延迟释放
+        SharedPtrReleaseBuffer buffer;
+        std::vector<SharedPtr<Counted>> copies(100, p);
+        for (auto &c : copies)
+            buffer.defer(std::move(c));
+        assert(p.use_count() == 101 && !copies[0]);
+        buffer.flush();
+        assert(p.use_count() == 1);
+        buffer.defer(std::move(p));
+        assert(g_destroyed == 0);
+        buffer.flush();
+        assert(g_destroyed == 1);
+
+        // 超过缓冲区容量时自动 flush
+        std::vector<SharedPtr<Counted>> many;
+        for (int i = 0; i < 100; i++)
+            many.push_back(makeShared<Counted>());
+        for (auto &m : many)
+            deferRelease(std::move(m));
+        assert(g_destroyed > 1 && g_destroyed < 101);
+        flushDeferredReleases();
+        assert(g_destroyed == 101);
+    }
+
+    // 线程退出时自动 flush
+    auto shared = makeShared<Counted>();
+    std::thread([copy = shared]() mutable {
+        deferRelease(std::move(copy));
+    }).join();
+    assert(shared.use_count() == 1);
+
+    g_destroyed = 0;
+    double t_plain = bench_fanout<false>(4, 10000, 200);
+    double t_batched = bench_fanout<true>(4, 10000, 200);
+    assert(g_destroyed == 400);
+    printf("fan-out: copy + reset %.2f ns, share_n + deferRelease %.2f ns per subscriber\n", t_plain, t_batched);
+}
+
+// 每个线程往自己的槽里写完再丢掉引用，最后一个引用析构对象时读取所有槽
+// 释放路径缺少 release/acquire 时，ThreadSanitizer 会在这里报告数据竞争
+struct Ledger {
+    long slots[8] = {};
+    long *total;
+
+    explicit Ledger(long *t) : total(t) {}
+    ~Ledger() {
+        for (long s : slots)
+            *total += s;
+    }
+};
+
+// 销毁 n 个只有一个拥有者的 SharedPtr，keep_weak 为 true 时另外持有 WeakPtr，走不到唯一拥有者的快速路径
+static double bench_unique_release(bool keep_weak) {
+    long n = 1000000;
+    std::vector<SharedPtr<Counted>> ptrs;
+    std::vector<WeakPtr<Counted>> weaks;
+    for (long i = 0; i < n; i++) {
+        ptrs.push_back(makeShared<Counted>());
+        if (keep_weak)
+            weaks.emplace_back(ptrs.back());
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto &p : ptrs)
+        p.reset();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count() * 1e9 / n;
+}
+
+static void test_release() {
+    for (int round = 0; round < 50; round++) {
+        long total = 0;
+        std::vector<std::thread> threads;
+        {
+            auto ledger = makeShared<Ledger>(&total);
+            for (int t = 0; t < 8; t++) {
+                threads.emplace_back([t, copy = ledger]() mutable {
+                    copy->slots[t] = t + 1;
+                    copy.reset();
+                });
+            }
+        }
+        for (auto &t : threads)
+            t.join();
+        assert(total == 36);
+    }
+
+    // WeakPtr::lock 与最后一个强引用的释放竞争：要么拿到完整的对象，要么拿到空指针
+    for (int round = 0; round < 200; round++) {
+        auto p = makeShared<Ledger>(nullptr);
+        long sink = 0;
+        p->total = &sink;
+        WeakPtr<Ledger> w = p;
+        std::thread locker([w] {
+            for (int i = 0; i < 100; i++) {
+                if (auto q = w.lock())
+                    q->slots[0] = i;
+            }
+        });
+        p.reset();
+        locker.join();
+        assert(w.expired() && sink >= 0 && sink < 100);
+    }
+
+    // 唯一拥有者直接析构，控制块与对象都被释放
+    g_destroyed = 0;
+    {
+        auto p = makeShared<Counted>();
+        SharedPtr<Counted> q(new Counted);
+        p.reset();
+        q.reset();
+        assert(g_destroyed == 2);
+    }
+
+    g_destroyed = 0;
+    double t_unique = bench_unique_release(false);
+    double t_weak = bench_unique_release(true);
+    assert(g_destroyed == 2000000);
+    printf("release: sole owner %.2f ns, with WeakPtr %.2f ns\n", t_unique, t_weak);
+}
+
+struct Config {
+    static inline std::atomic<long> alive{0};
+    long version;
+    long checksum;
+
+    explicit Config(long v) : version(v), checksum(v * 31 + 7) { alive.fetch_add(1); }
+    ~Config() { checksum = -1; alive.fetch_sub(1); }
+};
+
+// 记录分配次数的分配器，用于确认控制块与数组只分配了一次
+template <class T>
+struct CountingAlloc {
+    using value_type = T;
+    long *allocs;
+
+    explicit CountingAlloc(long *a) : allocs(a) {}
+
+    template <class U>
+    CountingAlloc(CountingAlloc<U> const &that) : allocs(that.allocs) {}
+
+    T *allocate(std::size_t n) {
+        ++*allocs;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        --*allocs;
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+struct Element {
+    static inline int alive = 0, throw_at = -1, last_destroyed = -1;
+    int id;
+
+    Element() : id(alive) {
+        if (id == throw_at)
+            throw 42;
+        ++alive;
+    }
+
+    ~Element() { last_destroyed = id; --alive; }
+};
+
+static void test_array() {
+    {
+        auto buf = makeShared<unsigned char[]>(100);
+        for (int i = 0; i < 100; i++)
+            assert(buf[i] == 0);
+        buf[99] = 7;
+        SharedPtr<unsigned char[]> copy = buf;
+        assert(copy[99] == 7 && buf.use_count() == 2);
+        auto raw = makeSharedForOverwrite<unsigned char[]>(0);
+        assert(raw.use_count() == 1);
+    }
+    {
+        auto arr = makeShared<Element[]>(5);
+        assert(Element::alive == 5 && arr[4].id == 4);
+        arr.reset();
+        assert(Element::alive == 0 && Element::last_destroyed == 0); // 逆序析构
+        Element::throw_at = 3;
+        try {
+            makeShared<Element[]>(5);
+            assert(false);
+        } catch (int) {
+        }
+        assert(Element::alive == 0);
+        Element::throw_at = -1;
+
+        // 只给裸指针时用 delete[] 释放，ASan 下能检查出与 new[] 不匹配
+        SharedPtr<Element[]> owned(new Element[4]);
+        assert(Element::alive == 4 && owned[3].id == 3);
+        owned.reset(new Element[2]);
+        assert(Element::alive == 2);
+        SharedPtr<Element const[]> view(new Element[3]);
+        assert(Element::alive == 5);
+        SharedPtr<Element[2]> fixed(new Element[2]);
+        assert(Element::alive == 7);
+        owned.reset();
+        view.reset();
+        fixed.reset();
+        assert(Element::alive == 0);
+    }
+    {
+        SharedPtr<double[4]> fixed = makeShared<double[4]>();
+        fixed[3] = 1.5;
+        SharedPtr<double[]> view = fixed;
+        assert(view[3] == 1.5 && fixed.use_count() == 2);
+        struct alignas(64) Wide { char c; };
+        auto wide = makeShared<Wide[]>(3);
+        assert(reinterpret_cast<std::uintptr_t>(wide.get()) % 64 == 0);
+    }
+    {
+        long allocs = 0;
+        WeakPtr<Element> weak;
+        {
+            auto arr = allocateShared<Element[]>(CountingAlloc<Element>(&allocs), 10);
+            assert(allocs == 1 && Element::alive == 10);
+            weak = SharedPtr<Element>(arr, arr.get());
+            auto fixed = allocateSharedForOverwrite<int[16]>(CountingAlloc<int>(&allocs));
+            assert(allocs == 2);
+        }
+        assert(Element::alive == 0 && allocs == 1); // 还有弱引用，内存暂不归还
+        weak.reset();
+        assert(allocs == 0);
+    }
+
+    // 创建共享字节缓冲区：一次分配 vs new[] 加单独的控制块
+    long n = 1000000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++) {
+        auto b = makeSharedForOverwrite<unsigned char[]>(256);
+        asm volatile("" : : "r"(b.get()) : "memory");
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++) {
+        SharedPtr<unsigned char[]> b(new unsigned char[256], DefaultDeleter<unsigned char[]>());
+        asm volatile("" : : "r"(b.get()) : "memory");
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    printf("byte buffer: makeSharedForOverwrite %.2f ns, new[] + control block %.2f ns\n",
+           std::chrono::duration<double>(t1 - t0).count() * 1e9 / n,
+           std::chrono::duration<double>(t2 - t1).count() * 1e9 / n);
+}
+
+// 简单的单线程内存池：只向前分配，全部释放后才回到开头
+struct Arena {
+    alignas(64) unsigned char buf[4096];
+    std::size_t used = 0;
+    long live = 0;
+};
+
+template <class T>
+struct ArenaAlloc {
+    using value_type = T;
+    Arena *arena;
+
+    explicit ArenaAlloc(Arena *a) : arena(a) {}
+
+    template <class U>
+    ArenaAlloc(ArenaAlloc<U> const &that) : arena(that.arena) {}
+
+    T *allocate(std::size_t n) {
+        std::size_t off = (arena->used + alignof(T) - 1) / alignof(T) * alignof(T);
+        if (off + n * sizeof(T) > sizeof(arena->buf))
+            throw std::bad_alloc();
+        arena->used = off + n * sizeof(T);
+        ++arena->live;
+        return reinterpret_cast<T *>(arena->buf + off);
+    }
+
+    void deallocate(T *, std::size_t) {
+        if (--arena->live == 0)
+            arena->used = 0;
+    }
+};
+
+struct Message {
+    int seq;
+    char payload[60];
+};
+
+static void test_alloc() {
+    Arena arena;
+    {
+        // 对象与控制块都来自内存池
+        auto m = allocateShared<Message>(ArenaAlloc<Message>(&arena), Message{1, "hello"});
+        assert(arena.live == 1 && m->seq == 1);
+        auto raw = allocateSharedForOverwrite<Counted>(ArenaAlloc<Counted>(&arena));
+        assert(arena.live == 2);
+
+        // 对象已经在内存池里，只把控制块也放进去
+        ArenaAlloc<Message> alloc(&arena);
+        Message *p = alloc.allocate(1);
+        ::new (p) Message{2, "world"};
+        auto release = [alloc](Message *p) mutable { p->~Message(); alloc.deallocate(p, 1); };
+        SharedPtr<Message> q(p, release, alloc);
+        assert(arena.live == 4 && q.use_count() == 1);
+        SharedPtr<Message> q2 = q;
+        q.reset();
+        assert(arena.live == 4);
+        q2.reset(new Message{3, ""}, DefaultDeleter<Message>(), alloc);
+        assert(arena.live == 3 && q2->seq == 3);
+    }
+    assert(arena.live == 0 && arena.used == 0);
+
+    // 控制块分配失败时，对象由删除器释放
+    g_destroyed = 0;
+    arena.used = sizeof(arena.buf);
+    arena.live = 1;
+    try {
+        SharedPtr<Counted> p(new Counted, DefaultDeleter<Counted>(), ArenaAlloc<Counted>(&arena));
+        assert(false);
+    } catch (std::bad_alloc const &) {
+    }
+    assert(g_destroyed == 1);
+}
+
+static void test_atomic() {
+    AtomicSharedPtr<int> a;
+    assert(!a.load());
+    auto one = makeShared<int>(1), two = makeShared<int>(2);
+    a.store(one);
+    assert(a.load() == one);
+    assert(one.use_count() == 2);
+    assert(a.exchange(two) == one);
+    assert(one.use_count() == 1);
+    SharedPtr<int> expected = one;
+    assert(!a.compare_exchange_strong(expected, nullptr) && expected == two);
+    assert(a.compare_exchange_strong(expected, one) && a.load() == one);
+    a.store(nullptr);
+    assert(one.use_count() == 1 && two.use_count() == 2); // expected 仍持有 two
+    expected = nullptr;
+    assert(a.compare_exchange_strong(expected, two) && a.load() == two);
+
+    // 配置热更新：一个写者不断发布新配置，多个读者不断读取；读到的配置必须完整且存活
+    {
+        AtomicSharedPtr<Config> current(makeShared<Config>(0));
+        std::atomic<bool> stop{false};
+        std::atomic<long> reads{0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; t++) {
+            readers.emplace_back([&] {
+                long last = 0, n = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    SharedPtr<Config> c = current.load();
+                    assert(c->checksum == c->version * 31 + 7);
+                    assert(c->version >= last); // 单个写者按顺序发布
+                    last = c->version;
+                    n++;
+                }
+                reads.fetch_add(n);
+            });
+        }
+        for (long v = 1; v <= 20000; v++) {
+            if (v % 2)
+                current.store(makeShared<Config>(v));
+            else {
+                SharedPtr<Config> exp = current.load();
+                assert(current.compare_exchange_strong(exp, makeShared<Config>(v)));
+            }
+        }
+        stop = true;
+        for (auto &t : readers)
+            t.join();
+        assert(current.load()->version == 20000);
+    }
+    assert(Config::alive.load() == 0);
+
+    // 读吞吐量：与互斥锁保护的 SharedPtr 对比
+    AtomicSharedPtr<Config> lockfree(makeShared<Config>(1));
+    SharedPtr<Config> guarded = makeShared<Config>(1);
+    std::mutex mtx;
+    long n = 2000000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++) {
+        SharedPtr<Config> c = lockfree.load();
+        asm volatile("" : : "r"(c.get()) : "memory");
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++) {
+        SharedPtr<Config> c;
+        {
+            std::lock_guard lck(mtx);
+            c = guarded;
+        }
+        asm volatile("" : : "r"(c.get()) : "memory");
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    printf("load: AtomicSharedPtr %.2f ns, mutex + SharedPtr %.2f ns\n",
+           std::chrono::duration<double>(t1 - t0).count() * 1e9 / n,
+           std::chrono::duration<double>(t2 - t1).count() * 1e9 / n);
+}
+
 int main() {
+    test_local();
+    test_weak();
+    test_array();
+    test_alloc();
+    test_batch();
+    test_release();
+    test_atomic();
+
     SharedPtr<Student> p0(new StudentDerived("彭于斌", 23));
     auto dp = staticPointerCast<StudentDerived>(p0);
     SharedPtr<Student const> bp = p0;
@@ -1,4 +1,137 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <random>
 #include <string>
+#include <vector>
+#include "String.hpp"
+
+static void test_basic() {
+    String s = "hello";
+    s += ", world";
+    s.insert(0, "[");
+    s.push_back(']');
+    assert(s == "[hello, world]");
+    s.replace(1, 5, "bonjour");
+    assert(s == "[bonjour, world]");
+    s.erase(8, 7);
+    assert(s == "[bonjour]");
+    String t = s + s + "!";
+    assert(t.size() == 19 && t.ends_with("]!"));
+    t.append(t); // 自身追加自身
+    assert(t.size() == 38 && t.substr(19) == t.substr(0, 19));
+    assert(String("abc") < String("abd"));
+    printf("s = %s, t = %s\n", s.c_str(), t.c_str());
+}
+
+// 与 std::string 的结果逐一对比
+static void test_search() {
+    std::mt19937 rng(42);
+    for (int round = 0; round < 200; round++) {
+        std::size_t n = rng() % 300;
+        std::string ref;
+        for (std::size_t i = 0; i < n; i++)
+            ref.push_back("abcdxyz\x80\xff"[rng() % 9]);
+        String s(ref.data(), ref.size());
+        std::string needle;
+        std::size_t m = rng() % 5;
+        for (std::size_t i = 0; i < m; i++)
+            needle.push_back("abcd\xff"[rng() % 5]);
+        for (std::size_t pos = 0; pos <= n + 1; pos += 1 + rng() % 7) {
+            assert(s.find(needle, pos) == ref.find(needle, pos));
+            assert(s.rfind(needle, pos) == ref.rfind(needle, pos));
+            assert(s.find(needle.empty() ? 'a' : needle[0], pos) == ref.find(needle.empty() ? 'a' : needle[0], pos));
+            assert(s.rfind('z', pos) == ref.rfind('z', pos));
+            assert(s.find_first_of(needle, pos) == ref.find_first_of(needle, pos));
+            assert(s.find_last_of(needle, pos) == ref.find_last_of(needle, pos));
+            assert(s.find_first_not_of(needle, pos) == ref.find_first_not_of(needle, pos));
+            assert(s.find_last_not_of(needle, pos) == ref.find_last_not_of(needle, pos));
+        }
+        assert(s.rfind(needle) == ref.rfind(needle));
+        assert(s.find_last_of(needle) == ref.find_last_of(needle));
+    }
+    printf("search results match std::string\n");
+}
+
+// 运行时只会选中一种实现，这里把每种当前 CPU 支持的实现都与 std::string 对比一遍
+static void test_search_ops() {
+    std::vector<_StrSearchOps const *> all;
+#if _LIBPENGCXX_STRING_SIMD
+    all.push_back(&_StrSearchSse2::_S_ops);
+#else
+    all.push_back(&_StrSearchScalar::_S_ops);
+#endif
+#if _LIBPENGCXX_STRING_DISPATCH
+    if (__builtin_cpu_supports("ssse3"))
+        all.push_back(&_StrSearchSsse3::_S_ops);
+    if (__builtin_cpu_supports("avx2"))
+        all.push_back(&_StrSearchAvx2::_S_ops);
+#endif
+    std::mt19937 rng(7);
+    for (auto const *ops : all) {
+        for (int round = 0; round < 300; round++) {
+            std::string ref;
+            std::size_t n = rng() % 200;
+            for (std::size_t i = 0; i < n; i++)
+                ref.push_back("ab#\x80\xff"[rng() % 5]);
+            std::string needle;
+            for (std::size_t i = rng() % 4; i > 0; i--)
+                needle.push_back("ab#\xff"[rng() % 4]);
+            auto npos = [] (std::size_t r) { return r == std::string::npos ? _S_str_npos : r; };
+            char const *h = ref.data(), *p = needle.data();
+            std::size_t m = needle.size();
+            assert(ops->_M_find_char(h, n, '#') == npos(ref.find('#')));
+            assert(ops->_M_rfind_char(h, n, '\xff') == npos(ref.rfind('\xff')));
+            assert(ops->_M_find(h, n, p, m) == npos(ref.find(needle)));
+            assert(ops->_M_rfind(h, n, p, m) == npos(ref.rfind(needle)));
+            assert(ops->_M_find_set[0](h, n, p, m) == npos(ref.find_first_of(needle)));
+            assert(ops->_M_find_set[1](h, n, p, m) == npos(ref.find_first_not_of(needle)));
+            assert(ops->_M_rfind_set[0](h, n, p, m) == npos(ref.find_last_of(needle)));
+            assert(ops->_M_rfind_set[1](h, n, p, m) == npos(ref.find_last_not_of(needle)));
+        }
+    }
+    printf("%zd search implementations match std::string\n", all.size());
+}
+
+template <class Str, class F>
+static double bench(Str const &hay, F f) {
+    std::size_t volatile sink = 0;
+    int const reps = int(64 * 1024 * 1024 / hay.size()) + 1;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        asm volatile ("" : : "r" (hay.data()) : "memory"); // 阻止编译器把查找提到循环外
+        sink = sink + f(hay);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration<double>(t1 - t0).count();
+    return double(hay.size()) * reps / sec / 1e9; // GB/s
+}
+
+// 在 1 KB ~ 1 MB 的文本中查找位于末尾的目标，对比 std::string 的吞吐量
+static void bench_search() {
+    printf("%-8s %-16s %10s %10s\n", "size", "op", "String", "std");
+    for (std::size_t n = 1024; n <= 1024 * 1024; n *= 32) {
+        std::mt19937 rng(n);
+        std::string ref;
+        for (std::size_t i = 0; i < n; i++)
+            ref.push_back("abcdefghijklmnopqrstuvwxyz ,.\n"[rng() % 30]);
+        ref.replace(n - 16, 16, "ERROR: timeout!#");
+        String s(ref.data(), ref.size());
+        auto report = [&] (char const *op, auto f) {
+            printf("%-8zu %-16s %9.2f %9.2f  GB/s\n", n, op, bench(s, f), bench(ref, f));
+        };
+        report("find(char)", [] (auto const &h) { return h.find('#'); });
+        report("find(str)", [] (auto const &h) { return h.find("timeout"); });
+        report("rfind(str)", [] (auto const &h) { return h.rfind("!#E"); });
+        report("find_first_of", [] (auto const &h) { return h.find_first_of("#!:"); });
+    }
+}
 
 int main() {
+    test_basic();
+    test_search();
+    test_search_ops();
+    bench_search();
+    return 0;
 }
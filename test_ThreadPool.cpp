@@ -0,0 +1,199 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ThreadPool.hpp"
+
+// 对照组：一个互斥锁保护的 std::queue
+struct MutexPool {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::queue<MoveOnlyFunction<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+
+    explicit MutexPool(std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) {
+            threads.emplace_back([this] {
+                for (;;) {
+                    std::unique_lock lck(mtx);
+                    cv.wait(lck, [this] { return stopping || !tasks.empty(); });
+                    if (tasks.empty())
+                        return;
+                    auto fn = std::move(tasks.front());
+                    tasks.pop();
+                    lck.unlock();
+                    fn();
+                }
+            });
+        }
+    }
+
+    void submit(MoveOnlyFunction<void()> fn) {
+        {
+            std::lock_guard lck(mtx);
+            tasks.push(std::move(fn));
+        }
+        cv.notify_one();
+    }
+
+    ~MutexPool() {
+        {
+            std::lock_guard lck(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto &t : threads)
+            t.join();
+    }
+};
+
+static void wait_for(std::atomic<long> &counter, long target) {
+    for (long c; (c = counter.load()) != target; )
+        counter.wait(c);
+}
+
+template <class Pool>
+static double bench_submit(Pool &pool, long n) {
+    std::atomic<long> done{0};
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i++) {
+        pool.submit([&done, n] {
+            if (done.fetch_add(1) + 1 == n)
+                done.notify_all();
+        });
+    }
+    wait_for(done, n);
+    auto t1 = std::chrono::steady_clock::now();
+    return n / std::chrono::duration<double>(t1 - t0).count();
+}
+
+// 在任务中递归提交任务，检验工作线程本地队列与窃取
+static void spawn_tree(ThreadPool &pool, int depth, std::atomic<long> &leaves) {
+    if (depth == 0) {
+        if (leaves.fetch_add(1) + 1 == (1 << 12))
+            leaves.notify_all();
+        return;
+    }
+    pool.submit([&pool, depth, &leaves] { spawn_tree(pool, depth - 1, leaves); });
+    pool.submit([&pool, depth, &leaves] { spawn_tree(pool, depth - 1, leaves); });
+}
+
+// parallel_for 返回后立即退出栈帧，随后的调用会覆盖同一块栈
+// 最后一个分段在减到 0 之后还会 notify_all，完成状态若在调用者栈上，ASan 下会报告释放后使用
+static long short_frame(ThreadPool &pool, long seed) {
+    long out[4] = {};
+    pool.parallel_for(4, 1, [&] (std::size_t b, std::size_t) { out[b] = seed + long(b); });
+    return out[0] + out[3];
+}
+
+int main() {
+    std::size_t nthreads = std::max(2u, std::thread::hardware_concurrency());
+    {
+        ThreadPool pool(nthreads);
+        assert(pool.size() == nthreads);
+
+        std::atomic<long> leaves{0};
+        pool.submit([&] { spawn_tree(pool, 12, leaves); });
+        wait_for(leaves, 1 << 12);
+
+        Vector<MoveOnlyFunction<void()>> batch;
+        std::atomic<long> sum{0};
+        for (long i = 1; i <= 1000; i++)
+            batch.push_back([&sum, i] {
+                if (sum.fetch_add(i) + i == 500500)
+                    sum.notify_all();
+            });
+        pool.bulk_submit(std::move(batch));
+        wait_for(sum, 500500);
+
+        Vector<long> v(100000);
+        for (std::size_t i = 0; i < v.size(); i++)
+            v[i] = long(i);
+        pool.parallel_for(v, [] (long &x) { x *= 2; });
+        for (std::size_t i = 0; i < v.size(); i++)
+            assert(v[i] == long(i) * 2);
+
+        // 在任务内部嵌套 parallel_for：调用者会帮忙执行任务，不会死锁
+        std::atomic<long> nested{0};
+        pool.parallel_for(8, 1, [&] (std::size_t, std::size_t) {
+            pool.parallel_for(v, [&] (long &) { nested.fetch_add(1, std::memory_order_relaxed); }, 4096);
+        });
+        assert(nested == 8 * 100000);
+
+        // 分段抛出的异常在所有分段结束后由调用者重新抛出，嵌套时逐层传出
+        for (int round = 0; round < 20; round++) {
+            std::atomic<long> ran{0};
+            try {
+                pool.parallel_for(64, 1, [&] (std::size_t begin, std::size_t) {
+                    ran.fetch_add(1);
+                    if (begin == 17)
+                        throw std::runtime_error("chunk 17");
+                });
+                assert(false);
+            } catch (std::runtime_error const &e) {
+                assert(std::string(e.what()) == "chunk 17" && ran >= 1 && ran <= 64);
+            }
+        }
+        try {
+            pool.parallel_for(4, 1, [&] (std::size_t, std::size_t) {
+                pool.parallel_for(4, 1, [] (std::size_t b, std::size_t) {
+                    if (b == 2)
+                        throw 42;
+                });
+            });
+            assert(false);
+        } catch (int x) {
+            assert(x == 42);
+        }
+
+        for (long i = 0; i < 2000; i++)
+            assert(short_frame(pool, i) == 2 * i + 3);
+    }
+
+    // 析构时执行完所有已提交的任务
+    std::atomic<long> late{0};
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 1000; i++)
+            pool.submit([&] { late.fetch_add(1); });
+    }
+    assert(late == 1000);
+
+    long n = 1000000;
+    double ws, mq;
+    {
+        ThreadPool pool(nthreads);
+        ws = bench_submit(pool, n);
+    }
+    {
+        MutexPool pool(nthreads);
+        mq = bench_submit(pool, n);
+    }
+    printf("%zd threads, external submit: work-stealing %.2fM tasks/s, mutex queue %.2fM tasks/s\n",
+           nthreads, ws / 1e6, mq / 1e6);
+
+    // 工作线程内部提交：走本地队列
+    {
+        ThreadPool pool(nthreads);
+        std::atomic<long> done{0};
+        auto t0 = std::chrono::steady_clock::now();
+        pool.parallel_for(nthreads, 1, [&] (std::size_t, std::size_t) {
+            for (long i = 0; i < n / long(nthreads); i++)
+                pool.submit([&] { done.fetch_add(1, std::memory_order_relaxed); });
+        });
+        long total = n / long(nthreads) * long(nthreads);
+        while (done.load() != total)
+            std::this_thread::yield();
+        auto t1 = std::chrono::steady_clock::now();
+        printf("worker-local submit: %.2fM tasks/s\n", total / std::chrono::duration<double>(t1 - t0).count() / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "Unicode.hpp"
+
+static void encode(std::string &s, char32_t c) {
+    char buf[4];
+    s.append(buf, _S_utf8_encode(buf, c));
+}
+
+// 随机生成合法的 UTF-8，ascii_ratio 控制 ASCII 字符所占的比例
+static std::string random_utf8(std::mt19937 &rng, std::size_t n, double ascii_ratio) {
+    std::string s;
+    std::uniform_real_distribution<double> coin;
+    while (s.size() < n) {
+        char32_t c;
+        if (coin(rng) < ascii_ratio) {
+            c = rng() % 0x80;
+        } else {
+            switch (rng() % 3) {
+            case 0: c = 0x80 + rng() % (0x800 - 0x80); break;
+            case 1: c = 0x800 + rng() % (0x10000 - 0x800); break;
+            default: c = 0x10000 + rng() % (0x110000 - 0x10000); break;
+            }
+            if (c >= 0xd800 && c <= 0xdfff)
+                c = 0x4e2d;
+        }
+        encode(s, c);
+    }
+    return s;
+}
+
+static void check_validators(std::string_view s) {
+    bool expect = _S_utf8_validate_scalar(s.data(), s.size());
+    assert(validateUtf8(s) == expect);
+#if _LIBPENGCXX_UTF8_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        assert(_S_utf8_validate_avx2(s.data(), s.size()) == expect);
+#endif
+}
+
+template <class F>
+static double bench(F f, std::size_t bytes) {
+    int rounds = int(std::max<std::size_t>(1, (std::size_t(256) << 20) / bytes));
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        f();
+        asm volatile("" : : : "memory");
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    return double(bytes) * rounds / secs / 1e9;
+}
+
+int main() {
+    // 边界情况
+    assert(validateUtf8(""));
+    assert(validateUtf8("hello"));
+    assert(validateUtf8("\xe4\xb8\xad\xe6\x96\x87"));             // 中文
+    assert(validateUtf8("\xf0\x9f\x98\x80"));                     // U+1F600
+    assert(validateUtf8("\xf4\x8f\xbf\xbf"));                     // U+10FFFF
+    assert(!validateUtf8("\xf4\x90\x80\x80"));                    // U+110000
+    assert(!validateUtf8("\xc0\xaf"));                            // 超长编码
+    assert(!validateUtf8("\xe0\x80\xaf"));
+    assert(!validateUtf8("\xf0\x80\x80\xaf"));
+    assert(!validateUtf8("\xed\xa0\x80"));                        // 代理区
+    assert(!validateUtf8("\x80"));                                // 孤立的后续字节
+    assert(!validateUtf8("\xe4\xb8"));                            // 截断
+    assert(!validateUtf8("\xff"));
+
+    // 与标量实现逐一比较：合法输入、随机改动一个字节、随机截断，长度跨过 32 字节的块边界
+    std::mt19937 rng(42);
+    for (int i = 0; i < 20000; i++) {
+        std::string s = random_utf8(rng, rng() % 200, i % 2 ? 0.9 : 0.3);
+        assert(_S_utf8_validate_scalar(s.data(), s.size()));
+        check_validators(s);
+        if (!s.empty()) {
+            std::string t = s;
+            t[rng() % t.size()] = char(rng());
+            check_validators(t);
+            check_validators(std::string_view(s).substr(0, rng() % s.size()));
+        }
+    }
+
+    // 互相转换后应能还原
+    for (int i = 0; i < 2000; i++) {
+        std::string s = random_utf8(rng, rng() % 300, 0.5);
+        auto u16 = utf8ToUtf16(s);
+        auto u32 = utf8ToUtf32(s);
+        assert(u16.has_value() && u32.has_value());
+        auto back16 = utf16ToUtf8(std::u16string_view(u16->data(), u16->size()));
+        auto back32 = utf32ToUtf8(std::u32string_view(u32->data(), u32->size()));
+        assert(back16.has_value() && *back16 == s);
+        assert(back32.has_value() && *back32 == s);
+    }
+    assert(utf8ToUtf16("")->size() == 0 && utf32ToUtf8(U"")->empty());
+    assert(!utf8ToUtf16("\xc0\xaf").has_value());
+    assert(!utf16ToUtf8(u"\xd800").has_value());
+    assert(!utf16ToUtf8(std::u16string_view(u"\xdc00\xd800", 2)).has_value());
+    assert(!utf32ToUtf8(U"\x110000").has_value());
+    assert(utf16ToUtf8(u"\xd83d\xde00").value() == "\xf0\x9f\x98\x80");
+
+    // 吞吐量
+    printf("%-10s %-8s %10s %10s %10s %10s\n", "text", "size", "scalar", "dispatch", "to_utf16", "to_utf32");
+    for (double ratio : {1.0, 0.9, 0.0}) {
+        for (std::size_t n : {std::size_t(1) << 10, std::size_t(1) << 16, std::size_t(1) << 20}) {
+            std::string s = random_utf8(rng, n, ratio);
+            volatile bool sink = false;
+            double scalar = bench([&] { sink = _S_utf8_validate_scalar(s.data(), s.size()); }, s.size());
+            double dispatch = bench([&] { sink = validateUtf8(s); }, s.size());
+            double to16 = bench([&] { sink = utf8ToUtf16(s).has_value(); }, s.size());
+            double to32 = bench([&] { sink = utf8ToUtf32(s).has_value(); }, s.size());
+            printf("ascii %3.0f%% %-8zd %7.2fGB/s %7.2fGB/s %7.2fGB/s %7.2fGB/s\n",
+                   ratio * 100, s.size(), scalar, dispatch, to16, to32);
+        }
+    }
+    return 0;
+}
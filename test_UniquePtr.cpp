@@ -1,6 +1,11 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
+#include <cassert>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <vector>
 #include <iostream>
+#include <new>
 #include "UniquePtr.hpp"
 
 struct MyClass {
@@ -34,7 +39,132 @@ struct Cat : Animal {
     }
 };
 
+// 带状态的删除器：记录对象来自哪个内存池，释放时还给它
+struct Pool {
+    int freed = 0;
+};
+
+template <class T>
+struct PoolDeleter {
+    Pool *pool;
+
+    PoolDeleter(Pool *p = nullptr) : pool(p) {}
+
+    template <class U>
+    PoolDeleter(PoolDeleter<U> const &that) : pool(that.pool) {}
+
+    void operator()(T *p) const {
+        delete p;
+        pool->freed++;
+    }
+};
+
+// 偏移指针：保存相对映射区域起点的偏移，区域被映射到别的地址后依然有效
+static unsigned char *g_region_base = nullptr;
+
+template <class T>
+struct OffsetPtr {
+    std::uint32_t off = 0; // 0 表示空指针，区域开头不放对象
+
+    OffsetPtr() = default;
+    OffsetPtr(std::nullptr_t) {}
+    explicit OffsetPtr(T *p) : off(p ? std::uint32_t((unsigned char *)p - g_region_base) : 0) {}
+
+    T *get() const { return off ? (T *)(g_region_base + off) : nullptr; }
+    T *operator->() const { return get(); }
+    T &operator*() const { return *get(); }
+    explicit operator bool() const { return off != 0; }
+    bool operator==(OffsetPtr const &that) const { return off == that.off; }
+    bool operator!=(OffsetPtr const &that) const { return off != that.off; }
+    bool operator<(OffsetPtr const &that) const { return off < that.off; }
+    bool operator<=(OffsetPtr const &that) const { return off <= that.off; }
+    bool operator>(OffsetPtr const &that) const { return off > that.off; }
+    bool operator>=(OffsetPtr const &that) const { return off >= that.off; }
+};
+
+static int g_region_freed = 0;
+
+template <class T>
+struct RegionDeleter {
+    using pointer = OffsetPtr<T>;
+
+    void operator()(pointer p) const {
+        p->~T();
+        g_region_freed++;
+    }
+};
+
+static int g_aligned_destroyed = 0;
+
+struct alignas(64) Aligned {
+    int value = 7;
+    ~Aligned() { g_aligned_destroyed++; }
+};
+
+static void test_deleters() {
+    static_assert(sizeof(UniquePtr<int>) == sizeof(void *));
+    static_assert(sizeof(UniquePtr<int[]>) == sizeof(void *));
+    static_assert(sizeof(UniquePtr<int, PoolDeleter<int>>) == 2 * sizeof(void *));
+    static_assert(sizeof(UniquePtr<int, RegionDeleter<int>>) == sizeof(std::uint32_t));
+    static_assert(std::is_constructible_v<UniquePtr<int const[]>, UniquePtr<int[]> &&>);
+    static_assert(!std::is_constructible_v<UniquePtr<Animal[]>, UniquePtr<Dog[]> &&>);
+    static_assert(!std::is_constructible_v<UniquePtr<Animal>, UniquePtr<Dog[]> &&>);
+    static_assert(!std::is_constructible_v<UniquePtr<Dog>, UniquePtr<Animal> &&>);
+
+    {
+        UniquePtr<int> p;
+        UniquePtr<int[]> arr;
+        assert(p == nullptr && nullptr == p && !(p != nullptr) && arr == nullptr && !(nullptr != arr));
+        p = makeUnique<int>(1);
+        arr = makeUnique<int[]>(2);
+        assert(p != nullptr && nullptr != p && !(p == nullptr) && arr != nullptr && !(nullptr == arr));
+    }
+
+    // 转换与交换都要带上删除器
+    Pool a, b;
+    {
+        UniquePtr<Dog, PoolDeleter<Dog>> dog(new Dog(1), PoolDeleter<Dog>(&a));
+        UniquePtr<Animal, PoolDeleter<Animal>> animal = std::move(dog);
+        assert(!dog && animal.get_deleter().pool == &a);
+        UniquePtr<Animal, PoolDeleter<Animal>> other(new Dog(2), PoolDeleter<Animal>(&b));
+        animal.swap(other);
+        assert(animal.get_deleter().pool == &b && other.get_deleter().pool == &a);
+        other = std::move(animal); // 先用 a 释放原对象，再接管来自 b 的对象与删除器
+        assert(a.freed == 1 && other.get_deleter().pool == &b);
+    }
+    assert(a.freed == 1 && b.freed == 1);
+
+    // 对象放在“映射区域”里，UniquePtr 保存的是偏移量
+    alignas(16) static unsigned char region1[256], region2[256];
+    g_region_base = region1;
+    {
+        struct Point {
+            int x, y;
+        };
+        UniquePtr<Point, RegionDeleter<Point>> p(OffsetPtr<Point>(new (region1 + 16) Point{3, 4}));
+        assert(p && p->x == 3 && (*p).y == 4);
+        std::memcpy(region2, region1, sizeof(region1)); // 模拟区域被重新映射到另一个地址
+        g_region_base = region2;
+        assert(p->x == 3 && p.get().get() == (Point *)(region2 + 16));
+        auto q = std::move(p);
+        assert(!p && q->y == 4);
+    }
+    assert(g_region_freed == 1);
+
+    // 超对齐数组：new[] 与 delete[] 按元素的对齐分配与释放，ASan 会检查两者是否匹配
+    {
+        auto arr = makeUnique<Aligned[]>(5);
+        assert((std::uintptr_t)arr.get() % alignof(Aligned) == 0 && arr[4].value == 7);
+        UniquePtr<Aligned const[]> carr = std::move(arr);
+        assert(!arr && carr[0].value == 7);
+        carr.reset();
+        assert(g_aligned_destroyed == 5);
+    }
+}
+
 int main() {
+    test_deleters();
+
     std::vector<UniquePtr<Animal>> zoo;
     int age = 3;
     zoo.push_back(makeUnique<Cat>(age));
@@ -1,5 +1,13 @@
+#undef NDEBUG // Release 构建下也要执行 assert 检查
 #include "Variant.hpp"
+#include "Optional.hpp"
+#include "Vector.hpp"
+#include <cassert>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <string>
+#include <variant>
 
 void print(Variant<std::string, int, double> v) {
     v.visit([&] (auto v) {
@@ -14,6 +22,112 @@ void print(Variant<std::string, int, double> v) {
     // }
 }
 
+struct Add {
+    double operator()(int a, int b) const { return a + b; }
+    double operator()(int a, double b) const { return a + b; }
+    double operator()(double a, int b) const { return a + b; }
+    double operator()(double a, double b) const { return a + b; }
+    double operator()(std::string const &, auto) const { return -1; }
+    double operator()(auto, std::string const &) const { return -2; }
+    double operator()(std::string const &, std::string const &) const { return -3; }
+};
+
+// 编译期构造、访问与 visit
+constexpr int constexpr_check() {
+    Variant<int, double, char> v(3);
+    int r = v.visit([] (auto x) { return int(x) * 2; });
+    v = Variant<int, double, char>('a');
+    r += v.get<char>() == 'a';
+    Variant<int, double, char> w(2.0);
+    r += visit([] (auto x, auto y) { return int(x + y); }, v, w);
+    return r;
+}
+static_assert(constexpr_check() == 6 + 1 + 'a' + 2);
+
+template <size_t I>
+struct Tag {
+    int v = I;
+};
+
+// 超过 16 个可选类型时改为查表
+template <size_t ...Is>
+constexpr int big_variant_check(std::index_sequence<Is...>) {
+    int r = 0;
+    for (int k : {0, 7, 16, 19}) {
+        Variant<Tag<Is>...> v(Tag<0>{});
+        [&] <size_t ...Js> (std::index_sequence<Js...>) {
+            ((k == int(Js) ? (void)(v = Variant<Tag<Is>...>(inPlaceIndex<Js>)) : (void)0), ...);
+        }(std::index_sequence<Is...>());
+        r += v.visit([] (auto t) { return t.v; });
+    }
+    return r;
+}
+static_assert(big_variant_check(std::make_index_sequence<20>()) == 0 + 7 + 16 + 19);
+
+struct Leaf {}; struct Eof {};
+
+// 指针的空闲取值需要显式开启；Node 此时还不完整也没关系
+struct Node;
+template <>
+struct NicheTraits<Node *> : NichePointerTraits<Node *> {};
+struct Node { int value; };
+
+// 最小的 index 类型与空闲取值布局
+static_assert(sizeof(Variant<int, float>) == 8);
+static_assert(sizeof(Variant<char, bool>) == 2);
+static_assert(sizeof(Variant<Node *, Leaf, Eof>) == sizeof(Node *));
+static_assert(sizeof(Variant<int *, Leaf, Eof>) == 2 * sizeof(int *)); // 未开启时单独存放 index
+static_assert(sizeof(Variant<Optional<int>, Leaf>) == sizeof(Optional<int>));
+static_assert(sizeof(Variant<bool, Leaf>) == 1);
+static_assert(sizeof(Variant<int *, std::string>) == sizeof(std::string) + 8); // 两个都非空，不能使用空闲取值
+
+// 所有可选类型都平凡时，Variant 与 Optional 也平凡
+static_assert(std::is_trivially_copyable_v<Variant<int, float>>);
+static_assert(std::is_trivially_destructible_v<Variant<int, float>>);
+static_assert(std::is_trivially_copyable_v<Variant<Node *, Leaf, Eof>>);
+static_assert(std::is_trivially_copyable_v<Optional<int>>);
+static_assert(std::is_trivially_destructible_v<Optional<double>>);
+static_assert(std::is_trivially_copyable_v<Variant<Optional<int>, Leaf>>);
+static_assert(!std::is_trivially_copyable_v<Variant<int, std::string>>);
+static_assert(!std::is_trivially_destructible_v<Variant<int, std::string>>);
+static_assert(!std::is_trivially_copyable_v<Optional<std::string>>);
+static_assert(std::is_copy_constructible_v<Optional<std::string>>);
+
+template <class V, class T, class U>
+void check_niche(T t, U u) {
+    V a(t), b(u);
+    constexpr size_t i = VariantIndex<V, T>::value, j = VariantIndex<V, U>::value;
+    assert(a.index() == i && b.index() == j);
+    if constexpr (std::equality_comparable<T>)
+        assert(a.template get<T>() == t);
+    a = b;
+    assert(a.index() == j && a.template holds_alternative<U>());
+    V c(std::move(a));
+    assert(c.index() == j);
+    c = V(t);
+    assert(c.index() == i && c.template holds_alternative<T>());
+}
+
+static int g_tracked = 0;
+
+struct Tracked {
+    Tracked() { g_tracked++; }
+    Tracked(Tracked const &) { g_tracked++; }
+    Tracked(Tracked &&) noexcept { g_tracked++; }
+    Tracked &operator=(Tracked const &) = default;
+    ~Tracked() { g_tracked--; }
+};
+
+struct Fragile { // 拷贝构造总是抛出异常
+    Fragile() = default;
+    Fragile(Fragile const &) { throw 1; }
+    Fragile(Fragile &&) noexcept = default;
+    Fragile &operator=(Fragile const &) = default;
+};
+
+struct Idle {}; struct Read { int n; }; struct Write { int n; }; struct Flush {}; struct Done {};
+using State = Variant<Idle, Read, Write, Flush, Done>;
+
 int main() {
     Variant<std::string, int, double> v1(inPlaceIndex<0>, "asas");
     print(v1);
@@ -21,4 +135,115 @@ int main() {
     print(v2);
     Variant<std::string, int, double> v3(3.14);
     print(v3);
+
+    // 多个 Variant 的 visit
+    assert(visit(Add(), v2, v3) == 42 + 3.14);
+    assert(visit(Add(), v3, v3) == 3.14 + 3.14);
+    assert(visit(Add(), v1, v2) == -1);
+    assert(visit(Add(), v2, v1) == -2);
+    assert(visit(Add(), v1, v1) == -3);
+    assert(visit([] (auto const &x) { return sizeof(x); }, v2) == sizeof(int));
+
+    // 不会与 std::visit 冲突
+    std::variant<int, double> sv(1.5);
+    assert(visit([] (auto x) { return double(x); }, sv) == 1.5);
+
+    Variant<int, double> a(1), b(2.5);
+    Variant<int, double, char> c('x');
+    assert(visit([] (auto x, auto y, auto z) { return double(x) + double(y) + double(z); }, a, b, c) == 1 + 2.5 + 'x');
+    visit([] (auto &x, auto &y) { x = 10; y = 20; }, a, b); // 非 const 左值可以修改
+    assert(a.get<int>() == 10 && b.get<double>() == 20);
+
+    // 右值 Variant 访问得到右值引用，可以移走其中的值
+    Variant<std::string, int, double> v4(inPlaceIndex<0>, "moved");
+    std::string taken = visit([] (auto &&x) -> std::string {
+        if constexpr (std::is_same_v<decltype(x), std::string &&>)
+            return std::move(x);
+        else
+            return "";
+    }, std::move(v4));
+    assert(taken == "moved");
+
+    // 拷贝、移动赋值在不同可选类型间切换
+    Variant<std::string, int, double> v5(1);
+    v5 = v1;
+    assert(v5.get<std::string>() == "asas");
+    v5 = Variant<std::string, int, double>(2.5);
+    assert(v5.get<double>() == 2.5 && v5.get_if<std::string>() == nullptr);
+
+    // 拷贝抛出异常时赋值不生效，旧值既没有被析构，也不会在之后被析构两次
+    {
+        Variant<Tracked, Fragile> t(Tracked{}), f(Fragile{});
+        assert(g_tracked == 1);
+        try {
+            t = f;
+            assert(false);
+        } catch (int) {
+        }
+        assert(t.holds_alternative<Tracked>() && g_tracked == 1);
+        t = std::move(f); // 移动构造不抛出异常，直接析构旧值再构造
+        assert(t.holds_alternative<Fragile>() && g_tracked == 0);
+    }
+    assert(g_tracked == 0);
+
+    // 空闲取值布局下 index 由存储的位模式算出，nullptr 与合法指针都不与之冲突
+    Node x{0};
+    check_niche<Variant<Node *, Leaf, Eof>>(&x, Eof{});
+    check_niche<Variant<Node *, Leaf, Eof>>((Node *)nullptr, Leaf{});
+    check_niche<Variant<Leaf, Node *, Eof>>(Leaf{}, &x);
+    check_niche<Variant<bool, Leaf>>(true, Leaf{});
+    check_niche<Variant<bool, Leaf>>(false, Leaf{});
+    check_niche<Variant<Optional<int>, Eof>>(Optional<int>(3), Eof{});
+    check_niche<Variant<Optional<int>, Eof>>(Optional<int>(), Eof{});
+    {
+        Variant<Leaf, Eof, Node *> v(inPlaceIndex<1>);
+        assert(v.index() == 1);
+        assert(visit([] (auto p) { return std::is_same_v<decltype(p), Eof>; }, v));
+        v = Variant<Leaf, Eof, Node *>(&x);
+        assert(v.get<Node *>()->value == 0 && v.get_if<Eof>() == nullptr);
+    }
+    // 未开启空闲取值的指针可以存放任意值，如墓碑标记
+    {
+        Variant<int *, Leaf> v(reinterpret_cast<int *>(1));
+        assert(v.index() == 0 && v.get<int *>() == reinterpret_cast<int *>(1));
+        v = Variant<int *, Leaf>(Leaf{});
+        assert(v.index() == 1);
+    }
+
+    // 可平凡拷贝的 Variant / Optional 在 Vector 扩容时按字节搬运，值保持不变
+    {
+        Vector<Variant<int, float>> vv;
+        Vector<Optional<int>> vo;
+        for (int i = 0; i < 1000; i++) {
+            vv.push_back(i % 2 ? Variant<int, float>(i) : Variant<int, float>(float(i)));
+            vo.push_back(i % 3 ? Optional<int>(i) : Optional<int>(nullopt));
+        }
+        for (int i = 0; i < 1000; i++) {
+            assert(vv[i].index() == (i % 2 ? 0u : 1u));
+            assert(i % 2 ? vv[i].get<int>() == i : vv[i].get<float>() == float(i));
+            assert(vo[i].has_value() == (i % 3 != 0) && (!vo[i].has_value() || vo[i].value() == i));
+        }
+        Variant<int, float> c = vv[3];
+        c = vv[4];
+        assert(c.get<float>() == 4.0f);
+    }
+
+    // 状态机：每一步 visit 一个 5 个可选类型的 Variant
+    State s(Idle{});
+    long steps = 100000000, bytes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < steps; i++) {
+        s = s.visit([&] (auto &st) -> State {
+            using T = std::decay_t<decltype(st)>;
+            if constexpr (std::is_same_v<T, Idle>) return Read{int(i & 7)};
+            else if constexpr (std::is_same_v<T, Read>) return Write{st.n + 1};
+            else if constexpr (std::is_same_v<T, Write>) { bytes += st.n; return Flush{}; }
+            else if constexpr (std::is_same_v<T, Flush>) return (i & 1023) ? State(Idle{}) : State(Done{});
+            else return Idle{};
+        });
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    printf("state machine: %.2f ns/step (bytes=%ld)\n",
+           std::chrono::duration<double>(t1 - t0).count() * 1e9 / steps, bytes);
+    return 0;
 }